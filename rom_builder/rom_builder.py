@@ -2,7 +2,7 @@
 # GBA Multi Game Menu – ROM Builder
 # Author: Lesserkuma (github.com/lesserkuma)
 
-import sys, os, glob, json, math, re, struct, hashlib, argparse, datetime
+import sys, os, glob, json, math, re, struct, hashlib, argparse, datetime, zlib, time, unicodedata, concurrent.futures
 
 # Configuration
 app_version = "1.1"
@@ -14,6 +14,266 @@ def UpdateSectorMap(start, length, c):
 	sector_map[start + 1:start + length] = c * (length - 1)
 	sector_map[start] = c.upper()
 
+def AddExtent(offset, data=None, file=None, length=None, fill=0xFF):
+	# Occupied parts of the flash; ROM data is only referenced by file name and read while writing the output
+	if length is None:
+		length = len(data) if data is not None else os.path.getsize(file)
+	extents.append({"offset":offset, "length":length, "data":data, "file":file, "fill":fill})
+
+def ReadRange(start, end, chunk_size=0x100000):
+	# Yields the compilation's contents between start and end in chunks, blank space reads as 0xFF
+	pos = start
+	for extent in sorted(extents, key=lambda extent: extent["offset"]):
+		ext_start = max(extent["offset"], start)
+		ext_end = min(extent["offset"] + extent["length"], end)
+		if ext_start >= ext_end: continue
+		while pos < ext_start:
+			size = min(chunk_size, ext_start - pos)
+			yield blank[:size]
+			pos += size
+		if extent["file"] is not None:
+			f = open(extent["file"], "rb")
+			f.seek(pos - extent["offset"])
+		while pos < ext_end:
+			size = min(chunk_size, ext_end - pos)
+			if extent["file"] is not None:
+				chunk = f.read(size)
+			else:
+				chunk = extent["data"][pos - extent["offset"]:pos - extent["offset"] + size]
+			if len(chunk) < size:
+				chunk = bytes(chunk) + bytes([extent["fill"]]) * (size - len(chunk))
+			yield chunk
+			pos += size
+		if extent["file"] is not None:
+			f.close()
+	while pos < end:
+		size = min(chunk_size, end - pos)
+		yield blank[:size]
+		pos += size
+
+def WriteRange(f, start, end):
+	# Writes part of the compilation and keeps a hash of every sector for the next incremental build
+	pos = start
+	hasher = None
+	for chunk in ReadRange(start, end):
+		f.write(chunk)
+		view = memoryview(chunk)
+		while len(view) > 0:
+			if pos % sector_size == 0: hasher = hashlib.sha1()
+			size = min(len(view), sector_size - pos % sector_size)
+			hasher.update(view[:size])
+			view = view[size:]
+			pos += size
+			if pos % sector_size == 0: sector_hashes[pos // sector_size - 1] = hasher.hexdigest()
+
+def WriteSectorList(file_name, comment, sectors):
+	with open(file_name, "w") as f:
+		f.write(f"# {comment:s} (offset, length)\n")
+		i = 0
+		while i < len(sectors):
+			if not sectors[i]:
+				i += 1
+				continue
+			start = i
+			while i < len(sectors) and sectors[i]: i += 1
+			f.write(f"0x{start * sector_size:08X} 0x{(i - start) * sector_size:08X}\n")
+
+def DetectSaveType(buffer):
+	# Save types match SAVE_TYPE in the menu (1 = 32 KiB, 2 = 64 KiB, 3 = 128 KiB); buffer can also be a set of found signatures
+	if b"FLASH1M_V" in buffer:
+		return 3
+	if b"FLASH_V" in buffer or b"FLASH512_V" in buffer:
+		return 2
+	if b"SRAM_V" in buffer or b"SRAM_F_V" in buffer or b"EEPROM_V" in buffer:
+		return 1
+	return None
+
+def PlaceGames(games, occupied, start, offsets):
+	# First fit at aligned offsets; returns False as soon as a game doesn't fit
+	next_start = {}
+	for game in games:
+		n = game["sector_count"]
+		a = game["align"]
+		i = next_start.get((a, n), -(-start // a) * a)
+		while i + n <= len(occupied):
+			if occupied.find(1, i, i + n) == -1:
+				occupied[i:i + n] = b"\x01" * n
+				offsets[game["index"]] = i
+				next_start[(a, n)] = i + a
+				break
+			i += a
+		else:
+			return False
+	return True
+
+def PlaceGamesGreedy(games, occupied, start):
+	# Previous placement strategy: largest first, games that don't fit are skipped
+	occupied = bytearray(occupied)
+	offsets = {}
+	for game in sorted(games, key=lambda game: game["size"], reverse=True):
+		PlaceGames([game], occupied, start, offsets)
+	return offsets
+
+def PlaceSet(games, occupied, start):
+	# Placing games in order of decreasing alignment keeps the free space buddy-aligned, so
+	# first fit never fragments it and holes inside map_256m windows are filled by smaller games
+	occupied = bytearray(occupied)
+	offsets = {}
+	if not PlaceGames(sorted(games, key=lambda game: (game["align"], game["sector_count"]), reverse=True), occupied, start, offsets):
+		return None
+	return offsets
+
+def FindPlacement(games, occupied, start, fallback, budget=500):
+	offsets = PlaceSet(games, occupied, start)
+	if offsets is not None:
+		return offsets
+	
+	def Score(offsets):
+		return (len(offsets), sum(game["sector_count"] for game in games if game["index"] in offsets))
+	
+	# Not everything fits. Start with the largest placeable set of the smallest games (games listed
+	# later in the config are dropped first), then add the other games that still fit, smallest
+	# first. This is only a first guess: a map_256m game covers just its own sectors but needs a
+	# 32 MiB window start for itself, and the menu and previews at the start of the flash break the
+	# buddy alignment of the free space.
+	by_size = sorted(games, key=lambda game: (game["sector_count"], game["align"]))
+	lo, hi = 0, len(by_size)
+	while lo < hi:
+		mid = (lo + hi + 1) // 2
+		if PlaceSet(by_size[:mid], occupied, start) is not None:
+			lo = mid
+		else:
+			hi = mid - 1
+	chosen = by_size[:lo]
+	free = occupied[start:].count(0)
+	used = sum(game["sector_count"] for game in chosen)
+	for game in by_size[lo:]:
+		if used + game["sector_count"] <= free and PlaceSet(chosen + [game], occupied, start) is not None:
+			chosen.append(game)
+			used += game["sector_count"]
+	best = PlaceSet(chosen, occupied, start) or {}
+	if Score(fallback) > Score(best):
+		best = fallback
+	
+	# Branch and bound over the games, smallest first, with a limited number of placement attempts.
+	# The bound counts the remaining games that fit into the free sectors, and at most one
+	# map_256m game per free 32 MiB window start.
+	windows = {}
+	for game in games:
+		if game["align"] > game["sector_count"] and game["align"] not in windows:
+			windows[game["align"]] = sum(1 for i in range(-(-start // game["align"]) * game["align"], len(occupied), game["align"]) if occupied[i] == 0)
+	best_score = Score(best)
+	attempts = budget
+	def Search(i, chosen, used, windows_used):
+		nonlocal best, best_score, attempts
+		count = len(chosen)
+		size = used
+		bound_windows = dict(windows_used)
+		for game in by_size[i:]:
+			a = game["align"]
+			if size + game["sector_count"] > free: break
+			if a in windows:
+				if bound_windows.get(a, 0) >= windows[a]: continue
+				bound_windows[a] = bound_windows.get(a, 0) + 1
+			count += 1
+			size += game["sector_count"]
+		if (count, min(free, used + sum(game["sector_count"] for game in by_size[i:]))) <= best_score:
+			return
+		for j in range(i, len(by_size)):
+			game = by_size[j]
+			a = game["align"]
+			if used + game["sector_count"] > free or (a in windows and windows_used.get(a, 0) >= windows[a]):
+				continue
+			if attempts <= 0:
+				return
+			attempts -= 1
+			offsets = PlaceSet(chosen + [game], occupied, start)
+			if offsets is None:
+				continue
+			if Score(offsets) > best_score:
+				best = offsets
+				best_score = Score(offsets)
+			Search(j + 1, chosen + [game], used + game["sector_count"], {**windows_used, a:windows_used.get(a, 0) + 1} if a in windows else windows_used)
+	Search(0, [], 0, {})
+	return best
+
+def ScanRom(file):
+	# Reads a ROM file once in chunks to hash it, look for the batteryless patch and save library signatures
+	# and find where the trailing 0xFF or 0x00 padding starts
+	signatures = [b"Batteryless mod by Lesserkuma", b"FLASH1M_V", b"FLASH_V", b"FLASH512_V", b"SRAM_F_V", b"SRAM_V", b"EEPROM_V"]
+	overlap = max(len(signature) for signature in signatures) - 1
+	found = set()
+	hasher = hashlib.sha1()
+	tail = b""
+	pos = 0
+	content_end = [0, 0]
+	with open(file, "rb") as f:
+		while True:
+			chunk = f.read(0x100000)
+			if not chunk: break
+			hasher.update(chunk)
+			for (i, pad) in enumerate([b"\xFF", b"\x00"]):
+				length = len(chunk.rstrip(pad))
+				if length > 0: content_end[i] = pos + length
+			pos += len(chunk)
+			window = tail + chunk
+			for signature in signatures:
+				if signature not in found and signature in window:
+					found.add(signature)
+			tail = window[-overlap:]
+	return {"hash":hasher.hexdigest(), "batteryless":b"Batteryless mod by Lesserkuma" in found, "eeprom":b"EEPROM_V" in found, "save_type":DetectSaveType(found), "content_end":min(content_end)}
+
+def MappingSize(size, batteryless):
+	# Smallest mapping window for the given amount of ROM data
+	if ((size & (size - 1)) != 0):
+		x = 0x80000
+		while (x < size): x *= 2
+		size = x
+	if size < 0x400000:
+		if batteryless:
+			size = max(0x400000, min_rom_size)
+		else:
+			size = max(size, min_rom_size)
+	return size
+
+def MenuBackgroundOffset(menu_rom):
+	# The background bitmap (0x9600 bytes) and its palette (0x200 bytes) are linked right before the menu's font
+	pos = menu_rom.find(b"LKFN\x01\x00")
+	if pos < 0: pos = menu_rom.find(b"RTFN\xFF\xFE") # menus that still contain the NFTR font
+	return pos - 0x9800 if pos >= 0x9800 else -1
+
+def CompressLZ77(data):
+	# GBA BIOS LZ77 (type 0x10): a flag byte per 8 blocks, each block a literal or a 3–18 byte copy from up to 4 KiB back
+	output = bytearray(struct.pack("<I", (len(data) << 8) | 0x10))
+	positions = {}
+	pos = 0
+	while pos < len(data):
+		flags_pos = len(output)
+		output.append(0)
+		for bit in range(8):
+			if pos >= len(data): break
+			best_length = 0
+			best_distance = 0
+			for candidate in reversed(positions.get(bytes(data[pos:pos + 3]), [])):
+				if pos - candidate > 0x1000: break
+				length = 0
+				while length < 18 and pos + length < len(data) and data[candidate + length] == data[pos + length]: length += 1
+				if length > best_length:
+					best_length = length
+					best_distance = pos - candidate
+					if length == 18: break
+			if best_length >= 3:
+				output[flags_pos] |= 0x80 >> bit
+				output += bytes([((best_length - 3) << 4) | ((best_distance - 1) >> 8), (best_distance - 1) & 0xFF])
+			else:
+				best_length = 1
+				output.append(data[pos])
+			for i in range(pos, pos + best_length):
+				positions.setdefault(bytes(data[i:i + 3]), []).append(i)
+			pos += best_length
+	output += bytearray(-len(output) % 4)
+	return output
+
 def formatFileSize(size):
 	if size == 1:
 		return "{:d} Byte".format(size)
@@ -26,6 +286,13 @@ def formatFileSize(size):
 		val = size/1024/1024
 		return "{:.2f} MB".format(val)
 
+def Timing(name):
+	# Records how long the build phase that just ended took (see --timings)
+	global timing_start
+	timing_end = time.perf_counter()
+	timings.append((name, timing_end - timing_start))
+	timing_start = timing_end
+
 def logp(*args, **kwargs):
 	global log
 	s = format(" ".join(map(str, args)))
@@ -65,16 +332,22 @@ cartridge_types = [
 ]
 now = datetime.datetime.now()
 log = ""
+timings = []
+timing_start = time.perf_counter()
 
 logp("GBA Multi Game Menu ROM Builder v{:s}\nby Lesserkuma\n".format(app_version))
 class ArgParseCustomFormatter(argparse.ArgumentDefaultsHelpFormatter, argparse.RawDescriptionHelpFormatter): pass
 parser = argparse.ArgumentParser()
 parser.add_argument("--split", help="splits output files into 32 MiB parts", action="store_true", default=False)
+parser.add_argument("--sector-list", help="writes a list of non-empty sectors next to the compilation ROM", action="store_true", default=False)
 parser.add_argument("--no-wait", help="don’t wait for user input when finished", action="store_true", default=False)
+parser.add_argument("--timings", help="prints how long each build phase took", action="store_true", default=False)
 parser.add_argument("--no-log", help="don’t write a log file", action="store_true", default=False)
 parser.add_argument("--config", type=str, default="config.json", help="sets the config file to use")
 parser.add_argument("--bg", type=str, help="sets the background image to use")
 parser.add_argument("--output", type=str, default=default_file, help="sets the file name of the compilation ROM")
+parser.add_argument("--layout", type=str, default="layout.json", help="sets the file that keeps the ROM layout between builds")
+parser.add_argument("--fresh-layout", help="ignores the previous ROM layout", action="store_true", default=False)
 args = parser.parse_args()
 output_file = args.output
 if output_file == "lk_multimenu.gba":
@@ -143,6 +416,8 @@ else:
 		else:
 			min_rom_size = 0x400000
 
+Timing("config")
+
 # Prepare compilation
 flash_size = cartridge_types[cartridge_type]["flash_size"]
 sector_size = cartridge_types[cartridge_type]["sector_size"]
@@ -150,11 +425,10 @@ sector_count = flash_size // sector_size
 block_size = cartridge_types[cartridge_type]["block_size"]
 block_count = flash_size // block_size
 sectors_per_block = 0x80000 // sector_size
-compilation = bytearray()
+extents = []
+blank = memoryview(bytes([0xFF] * 0x100000))
+sector_hashes = [None] * sector_count
 roms_keys = [0]
-for i in range(flash_size // 0x2000000):
-	chunk = bytearray([0xFF] * 0x2000000)
-	compilation += chunk
 sector_map = list("." * sector_count)
 
 # Read menu ROM
@@ -163,7 +437,11 @@ with open("lk_multimenu.gba", "rb") as f:
 	menu_rom += bytearray([0xFF] * ((len(menu_rom) + 0x10 - (len(menu_rom) % 0x10)) - len(menu_rom)))
 	menu_rom += bytearray([0xFF] * 0x20)
 	build_timestamp_offset = len(menu_rom) - 0x20
-	build_timestamp = datetime.datetime.now().astimezone().replace(microsecond=0).isoformat().encode("ASCII")
+	if "SOURCE_DATE_EPOCH" in os.environ:
+		# Fixed timestamp for reproducible builds
+		build_timestamp = datetime.datetime.fromtimestamp(int(os.environ["SOURCE_DATE_EPOCH"]), datetime.timezone.utc).isoformat().encode("ASCII")
+	else:
+		build_timestamp = datetime.datetime.now().astimezone().replace(microsecond=0).isoformat().encode("ASCII")
 	menu_rom[build_timestamp_offset:build_timestamp_offset+len(build_timestamp)] = build_timestamp
 
 # Change background image
@@ -183,14 +461,17 @@ if args.bg or os.path.exists("bg.png"):
 		for color in palette_rgb555:
 			raw_palette[pos:pos+2] = struct.pack("<H", color)
 			pos += 2
-		menu_rom_bg_offset = menu_rom.find(b"RTFN\xFF\xFE") - 0x9800
-		menu_rom[menu_rom_bg_offset:menu_rom_bg_offset+0x9600] = raw_bitmap
-		menu_rom[menu_rom_bg_offset+0x9600:menu_rom_bg_offset+0x9800] = raw_palette
+		menu_rom_bg_offset = MenuBackgroundOffset(menu_rom)
+		if menu_rom_bg_offset < 0:
+			logp("Error: Couldn’t update background image. The menu ROM has no background image.")
+		else:
+			menu_rom[menu_rom_bg_offset:menu_rom_bg_offset+0x9600] = raw_bitmap
+			menu_rom[menu_rom_bg_offset+0x9600:menu_rom_bg_offset+0x9800] = raw_palette
 	except ImportError:
 		print("Error: Couldn’t update background image. Pillow library is not installed.")
 
 menu_rom_size = menu_rom.find(b"dkARM\0\0\0") + 8
-compilation[0:len(menu_rom)] = menu_rom
+AddExtent(0, data=menu_rom)
 UpdateSectorMap(start=0, length=math.ceil(len(menu_rom) / sector_size), c="m")
 item_list_offset = len(menu_rom)
 item_list_offset = 0x40000 - (item_list_offset % 0x40000) + item_list_offset
@@ -202,33 +483,45 @@ if battery_present:
 	status = bytearray([0x4B, 0x55, 0x4D, 0x41, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00])
 else:
 	status = bytearray([0x4B, 0x55, 0x4D, 0x41, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00])
-compilation[status_offset * sector_size:status_offset * sector_size + len(status)] = status
+AddExtent(status_offset * sector_size, data=status)
 save_data_sector_offset = status_offset + 1
-boot_logo_found = hashlib.sha1(compilation[0x04:0xA0]).digest() == bytearray([ 0x17, 0xDA, 0xA0, 0xFE, 0xC0, 0x2F, 0xC3, 0x3C, 0x0F, 0x6A, 0xBB, 0x54, 0x9A, 0x8B, 0x80, 0xB6, 0x61, 0x3B, 0x48, 0xEE ])
+boot_logo_found = hashlib.sha1(menu_rom[0x04:0xA0]).digest() == bytearray([ 0x17, 0xDA, 0xA0, 0xFE, 0xC0, 0x2F, 0xC3, 0x3C, 0x0F, 0x6A, 0xBB, 0x54, 0x9A, 0x8B, 0x80, 0xB6, 0x61, 0x3B, 0x48, 0xEE ])
+
+Timing("menu")
 
 # Read game ROMs and import save data
 saves_read = []
+save_slots = {}
 games = [game for game in games if "enabled" in game and game["enabled"]]
+rom_files = sorted(set(f"roms/{game['file']}" for game in games if os.path.exists(f"roms/{game['file']}")))
+with concurrent.futures.ThreadPoolExecutor(max_workers=min(8, os.cpu_count() or 1)) as pool:
+	rom_scans = dict(zip(rom_files, pool.map(ScanRom, rom_files)))
 index = 0
 for game in games:
 	if not game["enabled"]: continue
 	if not os.path.exists(f"roms/{game['file']}"):
 		game["missing"] = True
 		continue
-	size = os.path.getsize(f"roms/{game['file']}")
-	if ((size & (size - 1)) != 0):
-		x = 0x80000
-		while (x < size): x *= 2
-		size = x
-	if size < 0x400000:
-		with open(f"roms/{game['file']}", "rb") as f:
-			buffer = f.read()
-			if b"Batteryless mod by Lesserkuma" in buffer:
-				size = max(0x400000, min_rom_size)
-			else:
-				size = max(size, min_rom_size)
+	file_size = os.path.getsize(f"roms/{game['file']}")
+	rom_scan = rom_scans[f"roms/{game['file']}"]
+	size = file_size
+	if rom_scan["batteryless"] or ("trim" in game and game["trim"] == False):
+		pass
+	elif rom_scan["eeprom"] and file_size > 0x1000000:
+		# EEPROM games bigger than 16 MiB expect the save chip at a different address, so keep them at 32 MiB
+		size = max(rom_scan["content_end"], 0x1000001)
+	else:
+		# Trailing padding doesn't need to be stored; the game only gets a mapping window big enough for the actual content
+		size = max(rom_scan["content_end"], 1)
+	size = MappingSize(size, rom_scan["batteryless"])
+	untrimmed_size = MappingSize(file_size, rom_scan["batteryless"])
+	if size < untrimmed_size:
+		game["trimmed_from"] = untrimmed_size
+	save_type = rom_scan["save_type"]
+	game["hash"] = rom_scan["hash"]
 	game["index"] = index
 	game["size"] = size
+	game["data_length"] = min(file_size, size)
 	if "title_font" in game:
 		game["title_font"] -= 1
 	else:
@@ -266,7 +559,9 @@ for game in games:
 		roms_keys = list(set(roms_keys))
 	
 	if battery_present and game["save_slot"] is not None:
-		game["save_type"] = 2
+		if save_type is None:
+			save_type = 2 # no known save library found, transfer the full 64 KiB
+		game["save_type"] = save_type
 		game["save_slot"] -= 1
 		save_slot = game["save_slot"]
 		offset = save_data_sector_offset + save_slot
@@ -274,63 +569,174 @@ for game in games:
 		
 		if save_slot not in saves_read:
 			save_data_file = os.path.splitext(f"roms/{game['file']}")[0] + ".sav"
-			save_data = bytearray([0] * sector_size)
+			save_data = bytearray()
 			if os.path.exists(save_data_file):
 				with open(save_data_file, "rb") as f:
 					save_data = f.read()
-				if len(save_data) < sector_size:
-					save_data += bytearray([0] * (sector_size - len(save_data)))
 				if len(save_data) > sector_size:
 					save_data = save_data[:sector_size]
 				saves_read.append(save_slot)
-			compilation[offset * sector_size:offset * sector_size + sector_size] = save_data
+			save_slots[save_slot] = save_data
 	else:
 		game["save_type"] = 0
 		game["save_slot"] = 0
 	index += 1
-if len(saves_read) > 0:
-	save_end_offset = (''.join(sector_map).rindex("S") + 1)
-else:
-	save_end_offset = save_data_sector_offset
+for save_slot in save_slots:
+	AddExtent((save_data_sector_offset + save_slot) * sector_size, data=save_slots[save_slot], length=sector_size, fill=0)
 
 games = [game for game in games if not ("missing" in game and game["missing"])]
 if len(games) == 0:
 	logp(f"No ROMs found. Delete the “{args.config:s}” file to reset your configuration.")
 	sys.exit()
 
+Timing("scan")
+
 # Add index
 index = 0
 for game in games:
 	game["index"] = index
 	index += 1
 
-# Read ROM data
-games.sort(key=lambda game: game["size"], reverse=True)
+# Preview images: scaled down, quantized to the background palette entries the background image leaves unused and LZ77 compressed
+preview_offset = len("".join(sector_map).rstrip(".")) # after the last save slot, even if it has no save data yet
+preview_area = bytearray()
+preview_games = [game for game in games if "preview" in game and game["preview"]]
 for game in games:
-	found = False
-	for i in range(save_end_offset, len(sector_map)):
-		sector_count_map = game["sector_count"]
-		
-		if "map_256m" in game and game["map_256m"] == True:
-			# Map as 256M ROM, but don't waste space; some games may need this for unknown reasons
-			sector_count_map = (32 * 1024 * 1024) // sector_size
-		
-		if i % sector_count_map == 0:
-			if sector_map[i:i + game["sector_count"]] == ["."] * game["sector_count"]:
-				UpdateSectorMap(i, game["sector_count"], "r")
-				with open(f"roms/{game['file']}", "rb") as f: rom = f.read()
-				compilation[i * sector_size:i * sector_size + len(rom)] = rom
-				game["sector_offset"] = i
-				game["block_offset"] = game["sector_offset"] * sector_size // block_size
-				game["block_count"] = sector_count_map * sector_size // block_size
-				found = True
-				
-				if not boot_logo_found and hashlib.sha1(rom[0x04:0xA0]).digest() == bytearray([ 0x17, 0xDA, 0xA0, 0xFE, 0xC0, 0x2F, 0xC3, 0x3C, 0x0F, 0x6A, 0xBB, 0x54, 0x9A, 0x8B, 0x80, 0xB6, 0x61, 0x3B, 0x48, 0xEE ]):
-					compilation[0x04:0xA0] = rom[0x04:0xA0] # boot logo
-					boot_logo_found = True
+	game["preview_index"] = 0xFFFF
+if len(preview_games) > 0:
+	try:
+		from PIL import Image
+		menu_rom_bg_offset = MenuBackgroundOffset(menu_rom)
+		free_colors = []
+		if menu_rom_bg_offset >= 0:
+			used_colors = set(menu_rom[menu_rom_bg_offset:menu_rom_bg_offset+0x9600])
+			free_colors = [i for i in range(0xF0) if i not in used_colors] # 0xF0 and up are text and sprite colors
+		if menu_rom_bg_offset < 0:
+			logp("Error: Couldn’t add preview images. The menu ROM has no background image.")
+			preview_games = []
+		elif len(free_colors) < 16:
+			logp("Error: Couldn’t add preview images. The background image uses too many colors.")
+			preview_games = []
+		images = []
+		for game in preview_games:
+			if not os.path.exists(f"roms/{game['preview']}"):
+				logp(f"Warning: Preview image “roms/{game['preview']:s}” wasn’t found.")
+				continue
+			images.append((game, Image.open(f"roms/{game['preview']}").convert("RGB").resize((60, 40), Image.LANCZOS)))
+		if len(images) > 0:
+			combined = Image.new("RGB", (60, 40 * len(images)))
+			for (i, (game, img)) in enumerate(images):
+				combined.paste(img, (0, i * 40))
+			combined = combined.quantize(colors=len(free_colors))
+			palette = combined.getpalette()
+			for (i, color) in enumerate(free_colors[:len(palette) // 3]):
+				(r, g, b) = palette[i*3:i*3+3]
+				menu_rom[menu_rom_bg_offset+0x9600+color*2:menu_rom_bg_offset+0x9600+color*2+2] = struct.pack("<H", ((b >> 3) << 10) | ((g >> 3) << 5) | (r >> 3))
+			color_map = bytearray(range(256))
+			color_map[:len(free_colors)] = bytes(free_colors)
+			pixels = combined.tobytes().translate(color_map)
+			streams = []
+			for (i, (game, img)) in enumerate(images):
+				stream = CompressLZ77(pixels[i * 60 * 40:(i + 1) * 60 * 40])
+				if stream not in streams: streams.append(stream)
+				game["preview_index"] = streams.index(stream)
+			preview_area = bytearray(b"LKPV") + struct.pack("<HHBBH", 1, len(streams), 60, 40, 0)
+			stream_offset = len(preview_area) + len(streams) * 4
+			for stream in streams:
+				preview_area += struct.pack("<I", stream_offset)
+				stream_offset += len(stream)
+			for stream in streams:
+				preview_area += stream
+			if (preview_offset * sector_size + len(preview_area) > 0x2000000) or (preview_offset + math.ceil(len(preview_area) / sector_size) > sector_count):
+				logp("Error: Couldn’t add preview images. They have to be within the first 32 MiB of the cartridge; use fewer save slots.")
+				preview_area = bytearray()
+				for game in games:
+					game["preview_index"] = 0xFFFF
+	except ImportError:
+		print("Error: Couldn’t add preview images. Pillow library is not installed.")
+preview_sector_count = math.ceil(len(preview_area) / sector_size)
+if preview_sector_count > 0:
+	UpdateSectorMap(preview_offset, preview_sector_count, "p")
+	AddExtent(preview_offset * sector_size, data=preview_area)
+rom_area_offset = preview_offset + preview_sector_count
+
+Timing("previews")
+
+# Place ROMs
+for game in games:
+	game["align"] = game["sector_count"]
+	if "map_256m" in game and game["map_256m"] == True:
+		# Map as 256M ROM, but don't waste space; some games may need this for unknown reasons
+		game["align"] = max(game["sector_count"], (32 * 1024 * 1024) // sector_size)
+
+# Identical ROMs share one copy in flash; the copy is taken from the game with the largest footprint (e.g. untrimmed), so it covers every other game's mapping
+placement = {}
+for game in games:
+	if game["hash"] not in placement:
+		placement[game["hash"]] = {"index":game["index"], "file":game["file"], "hash":game["hash"], "size":game["size"], "sector_count":game["sector_count"], "align":game["align"]}
+	else:
+		entry = placement[game["hash"]]
+		if game["sector_count"] > entry["sector_count"]:
+			entry.update({"index":game["index"], "file":game["file"], "size":game["size"], "sector_count":game["sector_count"]})
+		entry["align"] = max(entry["align"], game["align"])
+shared_count = len(games) - len(placement)
+roms = list(placement.values())
+
+occupied = bytearray([0 if c == "." else 1 for c in sector_map])
+greedy_offsets = PlaceGamesGreedy(roms, occupied, rom_area_offset)
+rom_offsets = FindPlacement(roms, occupied, rom_area_offset, greedy_offsets)
+
+# Keep ROMs where they were in the previous build, so only few sectors need to be reflashed
+previous_layout = None
+if not args.fresh_layout and os.path.exists(args.layout):
+	with open(args.layout, "r", encoding="UTF-8") as f:
+		previous_layout = json.load(f)
+	if previous_layout["cartridge_type"] != cartridge_type + 1 or previous_layout["sector_size"] != sector_size:
+		previous_layout = None
+if previous_layout is not None:
+	previous_roms = {}
+	for entry in previous_layout["games"]:
+		previous_roms.setdefault((entry["hash"], entry["align"]), []).append(entry["sector_offset"])
+	kept_occupied = bytearray(occupied)
+	kept_offsets = {}
+	for rom in roms:
+		for i in previous_roms.get((rom["hash"], rom["align"]), []):
+			if i >= rom_area_offset and i + rom["sector_count"] <= sector_count and kept_occupied.find(1, i, i + rom["sector_count"]) == -1:
+				kept_occupied[i:i + rom["sector_count"]] = b"\x01" * rom["sector_count"]
+				kept_offsets[rom["index"]] = i
+				previous_roms[(rom["hash"], rom["align"])].remove(i)
 				break
-	if not found:
+	new_roms = [rom for rom in roms if rom["index"] not in kept_offsets]
+	kept_offsets.update(FindPlacement(new_roms, kept_occupied, rom_area_offset, PlaceGamesGreedy(new_roms, kept_occupied, rom_area_offset)))
+	if len(kept_offsets) >= len(rom_offsets):
+		logp("Kept {:d} of {:d} ROM(s) at their previous location".format(len(roms) - len(new_roms), len(roms)))
+		rom_offsets = kept_offsets
+	else:
+		logp("Previous layout discarded; rearranging the ROMs fits {:d} more".format(len(rom_offsets) - len(kept_offsets)))
+greedy_size = sum(rom["size"] for rom in roms if rom["index"] in greedy_offsets)
+placed_size = sum(rom["size"] for rom in roms if rom["index"] in rom_offsets)
+
+Timing("placement")
+
+# Read ROM data
+for game in games:
+	rom_index = placement[game["hash"]]["index"]
+	if rom_index not in rom_offsets:
 		logp("“{:s}” couldn’t be added because it exceeds the available cartridge space.".format(game["title"]))
+		continue
+	i = rom_offsets[rom_index]
+	if rom_index == game["index"]:
+		UpdateSectorMap(i, game["sector_count"], "r")
+		AddExtent(i * sector_size, file=f"roms/{game['file']}", length=game["data_length"])
+	game["sector_offset"] = i
+	game["block_offset"] = game["sector_offset"] * sector_size // block_size
+	game["block_count"] = game["align"] * sector_size // block_size
+	
+	if not boot_logo_found:
+		with open(f"roms/{game['file']}", "rb") as f: rom_header = f.read(0xA0)
+		if hashlib.sha1(rom_header[0x04:0xA0]).digest() == bytearray([ 0x17, 0xDA, 0xA0, 0xFE, 0xC0, 0x2F, 0xC3, 0x3C, 0x0F, 0x6A, 0xBB, 0x54, 0x9A, 0x8B, 0x80, 0xB6, 0x61, 0x3B, 0x48, 0xEE ]):
+			menu_rom[0x04:0xA0] = rom_header[0x04:0xA0] # boot logo
+			boot_logo_found = True
 
 if not boot_logo_found:
 	logp("Warning: Valid boot logo is missing!")
@@ -344,21 +750,33 @@ logp("Sector map (1 block = {:d} KiB):".format(sector_size // 1024))
 for i in range(0, len(sector_map)):
 	logp(sector_map[i], end="")
 	if i % 64 == 63: logp("")
-sectors_used = len(re.findall(r'[MmSsRrIiCc]', "".join(sector_map)))
+sectors_used = len(re.findall(r'[MmSsRrIiCcPp]', "".join(sector_map)))
 logp("{:.2f}% ({:d} of {:d} sectors) used\n".format(sectors_used / sector_count * 100, sectors_used, sector_count))
-logp(f"Added {len(games)} ROM(s) to the compilation\n")
+logp(f"Added {len(games)} ROM(s) to the compilation")
+if shared_count > 0:
+	logp(f"{shared_count:d} ROM(s) share their data with an identical ROM")
+trimmed = [game for game in games if "trimmed_from" in game and placement[game["hash"]]["index"] == game["index"]]
+if len(trimmed) > 0:
+	logp("{:d} ROM(s) trimmed to their content, {:d} sector(s) ({:s}) reclaimed from padding".format(len(trimmed), sum((game["trimmed_from"] - game["size"]) // sector_size for game in trimmed), formatFileSize(sum(game["trimmed_from"] - game["size"] for game in trimmed))))
+if len(rom_offsets) != len(greedy_offsets) or placed_size != greedy_size:
+	logp("Placement: {:d} ROM(s) with {:s} fit; first-fit placement would have fit {:d} ROM(s) with {:s}".format(len(rom_offsets), formatFileSize(placed_size), len(greedy_offsets), formatFileSize(greedy_size)))
+logp("")
 
 if battery_present:
-	logp     ("    | Offset     | Map Size  | Save Slot      | Title")
-	toc_sep = "----+------------+-----------+----------------+--------------------------------"
+	logp     ("    | Offset     | Map Size  | Save Slot      | Save   | Title")
+	toc_sep = "----+------------+-----------+----------------+--------+-----------------------"
 else:
 	logp     ("    | Offset     | Map Size  | Title")
 	toc_sep = "----+------------+-----------+-------------------------------------------------"
 
-item_list = bytearray()
-
+# Item list: header, key group table, fixed-size records and a pool of deduplicated UTF-16 titles
+item_records = bytearray()
+item_groups = []
+string_pool = bytearray()
+string_offsets = {}
 for key in roms_keys:
 	c = 0
+	group_start = len(item_records) // 12
 	for game in games:
 		if game["keys"] != key: continue
 		
@@ -372,8 +790,9 @@ for key in roms_keys:
 		if battery_present:
 			if game['save_type'] > 0:
 				table_line += f"{game['save_slot']+1:2d} (0x{(save_data_sector_offset + game['save_slot']) * sector_size:07X}) | "
+				table_line += f"{[0, 32, 64, 64][game['save_type']]:2d} KiB | "
 			else:
-				table_line += "               | "
+				table_line += "               |        | "
 		table_line += f"{title}"
 		if c % 8 == 0:
 			if game['keys'] != 0:
@@ -384,32 +803,99 @@ for key in roms_keys:
 		logp(table_line)
 		c += 1
 		
-		title = title.ljust(0x30, "\0")
-		item_list += bytearray(struct.pack("B", game["title_font"]))
-		item_list += bytearray(struct.pack("B", len(game["title"])))
-		item_list += bytearray(struct.pack("<H", game["block_offset"]))
-		item_list += bytearray(struct.pack("<H", game["block_count"]))
-		item_list += bytearray(struct.pack("B", game["save_type"]))
-		item_list += bytearray(struct.pack("B", game["save_slot"]))
-		item_list += bytearray(struct.pack("<H", game["keys"]))
-		item_list += bytearray([0] * 6)
-		item_list += bytearray(title.encode("UTF-16LE"))
-
-compilation[item_list_offset * sector_size:item_list_offset * sector_size + len(item_list)] = item_list
+		title = title.encode("UTF-16LE")[:0x60]
+		if title not in string_offsets:
+			string_offsets[title] = len(string_pool) // 2
+			string_pool += title
+		game["item_pos"] = len(item_records) // 12
+		item_records += struct.pack("<BBHHBBHH", game["title_font"], len(title) // 2, game["block_offset"], game["block_count"], game["save_type"], game["save_slot"], string_offsets[title], game["preview_index"])
+	if c > 0:
+		item_groups.append((key, group_start, c))
+
+item_list_body = bytearray()
+for (key, group_start, group_count) in item_groups:
+	item_list_body += struct.pack("<HHHH", key, group_start, group_count, 0)
+item_list_body += item_records
+strings_offset = 20 + len(item_list_body)
+item_list_body += string_pool
+item_list_body += bytearray(-len(item_list_body) % 4)
+if 20 + len(item_list_body) > 0xE000:
+	logp("Error: The game list doesn’t fit into its sector. Please use fewer or shorter titles.")
+	if not args.no_wait: input("\nPress ENTER to exit.\n")
+	sys.exit(1)
+item_list_checksum = sum(struct.unpack(f"<{len(item_list_body) // 4:d}I", item_list_body)) & 0xFFFFFFFF
+item_list = bytearray(b"LKIL") + struct.pack("<HHHHHHI", 2, len(item_records) // 12, len(item_groups), strings_offset, 20 + len(item_list_body), preview_offset - item_list_offset if len(preview_area) > 0 else 0, item_list_checksum) + item_list_body
+AddExtent(item_list_offset * sector_size, data=item_list)
+
+# Generate alternative sort orders (by title, by ROM size, by save slot) for each list of games
+def SortTitle(game):
+	title = unicodedata.normalize("NFKC", game["title"]).casefold()
+	return re.sub(r"^(the|a|an) ", "", re.sub(r"^[^\w]+", "", title))
+sort_orders = [
+	lambda game: (SortTitle(game), game["item_pos"]),
+	lambda game: (game["size"], SortTitle(game), game["item_pos"]),
+	lambda game: (game["save_type"] == 0, game["save_slot"], game["item_pos"]),
+]
+item_count = len(item_records) // 12
+sort_tables = bytearray(b"LKSO") + struct.pack("<HHH", 1, item_count, len(sort_orders)) + bytearray(6)
+for sort_order in sort_orders:
+	table = [0] * item_count
+	for key in roms_keys:
+		group = sorted([game for game in games if game["keys"] == key], key=lambda game: game["item_pos"])
+		if len(group) == 0: continue
+		start = group[0]["item_pos"]
+		for (pos, game) in enumerate(sorted(group, key=sort_order)):
+			table[start + pos] = game["item_pos"]
+	sort_tables += struct.pack(f"<{item_count:d}H", *table)
+if 0xE000 + len(sort_tables) > 0x10000:
+	# The checksum manifest follows at 0x10000
+	logp("Error: The sort orders don’t fit into the game list sector. Please use at most {:d} games.".format((0x10000 - 0xE000 - 16) // (2 * len(sort_orders))))
+	if not args.no_wait: input("\nPress ENTER to exit.\n")
+	sys.exit(1)
+sort_tables_offset = item_list_offset * sector_size + 0xE000
+AddExtent(sort_tables_offset, data=sort_tables)
 rom_code = "L{:s}".format(hashlib.sha1(status + item_list).hexdigest()[:3]).upper()
 
 # Write compilation
 rom_size = len("".join(sector_map).rstrip(".")) * sector_size
-compilation[0xAC:0xB0] = rom_code.encode("ASCII")
+menu_rom[0xAC:0xB0] = rom_code.encode("ASCII")
 checksum = 0
 for i in range(0xA0, 0xBD):
-	checksum = checksum - compilation[i]
+	checksum = checksum - menu_rom[i]
 checksum = (checksum - 0x19) & 0xFF
-compilation[0xBD] = checksum
+menu_rom[0xBD] = checksum
+
+Timing("item list")
+
+# Write checksum manifest for the menu's verification mode
+manifest_offset = item_list_offset * sector_size + 0x10000
+manifest_entries = []
+manifest_entries.append((0, 0, 0, len(menu_rom)))
+manifest_entries.append((1, 0, item_list_offset * sector_size, len(item_list)))
+manifest_entries.append((1, 1, sort_tables_offset, len(sort_tables)))
+if len(preview_area) > 0:
+	manifest_entries.append((1, 2, preview_offset * sector_size, len(preview_area)))
+for game in games:
+	if placement[game["hash"]]["index"] != game["index"]: continue
+	manifest_entries.append((2, game["item_pos"], game["sector_offset"] * sector_size, game["data_length"]))
+for save_slot in sorted(set(game["save_slot"] for game in games if game["save_type"] > 0)):
+	manifest_entries.append((3, save_slot, (save_data_sector_offset + save_slot) * sector_size, min(0x10000, sector_size)))
+manifest = bytearray(b"LKVF") + struct.pack("<HH", 1, len(manifest_entries)) + bytearray(8)
+for (entry_type, entry_index, entry_offset, entry_length) in manifest_entries:
+	crc = 0
+	for chunk in ReadRange(entry_offset, entry_offset + entry_length):
+		crc = zlib.crc32(chunk, crc)
+	manifest += struct.pack("<BBHIII", entry_type, 0, entry_index, entry_offset, entry_length, crc)
+AddExtent(manifest_offset, data=manifest)
+Timing("checksums")
 logp("")
 logp("Menu ROM:        0x{:08X}–0x{:08X}".format(0, len(menu_rom)))
 logp("Game List:       0x{:08X}–0x{:08X}".format(item_list_offset * sector_size, item_list_offset * sector_size + len(item_list)))
+logp("Sort Orders:     0x{:08X}–0x{:08X}".format(sort_tables_offset, sort_tables_offset + len(sort_tables)))
+logp("Checksums:       0x{:08X}–0x{:08X}".format(manifest_offset, manifest_offset + len(manifest)))
 logp("Status Area:     0x{:08X}–0x{:08X}".format(status_offset * sector_size, status_offset * sector_size + 0x1000))
+if len(preview_area) > 0:
+	logp("Previews:        0x{:08X}–0x{:08X}".format(preview_offset * sector_size, preview_offset * sector_size + len(preview_area)))
 logp("")
 logp("Cartridge Type:  {:d} ({:s}) {:s}".format(cartridge_type + 1, cartridge_types[cartridge_type]["name"], "with battery" if battery_present else "without battery"))
 logp("Output ROM Size: {:.2f} MiB".format(rom_size / 1024 / 1024))
@@ -420,12 +906,46 @@ if args.split:
 	for i in range(0, math.ceil(flash_size / 0x2000000)):
 		pos = i * 0x2000000
 		size = 0x2000000
-		if pos > len(compilation[:rom_size]): break
+		if pos >= rom_size: break
 		if pos + size > rom_size: size = rom_size - pos
 		output_file_part = "{:s}_part{:d}{:s}".format(os.path.splitext(output_file)[0], i, os.path.splitext(output_file)[1])
-		with open(output_file_part, "wb") as f: f.write(compilation[pos:pos+size])
+		with open(output_file_part, "wb") as f: WriteRange(f, pos, pos + size)
 else:
-	with open(output_file, "wb") as f: f.write(compilation[:rom_size])
+	with open(output_file, "wb") as f: WriteRange(f, 0, rom_size)
+
+Timing("output")
+
+# Write list of sectors that aren't blank, so flashing tools can skip the rest
+if args.sector_list:
+	used = [False] * sector_count
+	for extent in extents:
+		for i in range(extent["offset"] // sector_size, -(-(extent["offset"] + extent["length"]) // sector_size)):
+			used[i] = True
+	WriteSectorList(os.path.splitext(output_file)[0] + "_sectors.txt", f"Non-empty {sector_size // 1024:d} KiB sectors of {output_file:s}; everything else is 0xFF", used)
+
+# Write list of sectors that changed since the previous build
+if previous_layout is not None:
+	changed = [sector_hashes[i] is not None and (i >= len(previous_layout["sector_hashes"]) or sector_hashes[i] != previous_layout["sector_hashes"][i]) for i in range(sector_count)]
+	WriteSectorList(os.path.splitext(output_file)[0] + "_delta.txt", f"{sector_size // 1024:d} KiB sectors of {output_file:s} that changed since {previous_layout['output']:s}", changed)
+	logp("Delta:           {:d} of {:d} sector(s) changed since the previous build ({:s})".format(changed.count(True), rom_size // sector_size, formatFileSize(changed.count(True) * sector_size)))
+
+# Save layout for the next build
+layout = {
+	"cartridge_type": cartridge_type + 1,
+	"sector_size": sector_size,
+	"output": output_file,
+	"games": [{"file": rom["file"], "hash": rom["hash"], "align": rom["align"], "sector_offset": rom_offsets[rom["index"]]} for rom in roms if rom["index"] in rom_offsets],
+	"sector_hashes": sector_hashes[:rom_size // sector_size],
+}
+with open(args.layout, "w", encoding="UTF-8") as f:
+	f.write(json.dumps(obj=layout, indent=4))
+
+Timing("layout")
+if args.timings:
+	logp("\nTimings:")
+	for (name, seconds) in timings:
+		logp(f"  {name:<12s} {seconds:8.3f} s")
+	logp(f"  {'total':<12s} {sum(seconds for (name, seconds) in timings):8.3f} s")
 
 # Write log
 if not args.no_log:
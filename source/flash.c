@@ -12,13 +12,27 @@ Author: Lesserkuma (github.com/lesserkuma)
 
 u8 flash_type;
 u8 *itemlist;
-u16 itemlist_offset;
+u16 itemlist_start;
 u32 flash_sector_size;
+u32 flash_buffer_size;
 u32 flash_itemlist_sector_offset;
 u32 flash_status_sector_offset;
 u32 flash_save_sector_offset;
 EWRAM_BSS u8 sram_register_backup[4];
-EWRAM_BSS u8 data_buffer[SRAM_SIZE];
+EWRAM_BSS u8 data_buffer[FLASH_BUFFER_SIZE_MAX];
+SaveWriteBack sSaveWriteBack;
+EWRAM_BSS FlashWear flash_wear;
+u16 rom_waitcnt_default;
+u16 rom_waitcnt;
+
+// Indexed by flash type - 1
+const FlashChip flash_chips[] = {
+	{0x88B0008A, 0x40000, 0x400}, // 6600M0U0BE
+	{0x7E7D0102, 0x20000, 0x20},  // MSP55LV100S
+	{0x227D0002, 0x20000, 0x40},  // MSP54LV100
+};
+u8 boot_fade_level;
+BOOL boot_fade_vblank;
 
 void FlashCalcOffsets(void)
 {
@@ -31,94 +45,244 @@ void FlashCalcOffsets(void)
 	itemlist = (u8 *)(AGB_ROM + flash_itemlist_sector_offset * flash_sector_size);
 }
 
-IWRAM_CODE void FlashDetectType(void)
+IWRAM_CODE u32 GetSaveSize(SAVE_TYPE save_type)
+{
+	switch (save_type)
+	{
+	case SRAM_256K:
+		return SRAM_SIZE_256K;
+	case SRAM_512K:
+		return SRAM_SIZE_512K;
+	case SRAM_1M:
+		return SRAM_SIZE; // mapper only exposes 64 KiB of SRAM
+	default:
+		return 0;
+	}
+}
+
+IWRAM_CODE static u32 FlashReadId(u8 type)
+{
+	u32 data = 0;
+
+	if (type == 1)
+	{
+		// 2G cart with 6600M0U0BE (369-in-1)
+		_FLASH_WRITE(0, 0xFF);
+		_FLASH_WRITE(0, 0x90);
+		data = _FLASH_READ(0) | ((u32)_FLASH_READ(2) << 16);
+		_FLASH_WRITE(0, 0xFF);
+	}
+	else if (type == 2)
+	{
+		// 512M cart with MSP55LV100S (Zelda Classic Collection 7-in-1)
+		_FLASH_WRITE(0, 0xF0F0);
+		_FLASH_WRITE(0xAAA, 0xAAA9);
+		_FLASH_WRITE(0x555, 0x5556);
+		_FLASH_WRITE(0xAAA, 0x9090);
+		data = _FLASH_READ(0) | ((u32)_FLASH_READ(2) << 16);
+		_FLASH_WRITE(0, 0xF0F0);
+	}
+	else if (type == 3)
+	{
+		// 1G cart with MSP54LV100S (Zelda Classic Collection 7-in-1)
+		_FLASH_WRITE(0, 0xF0);
+		_FLASH_WRITE(0xAAA, 0xA9);
+		_FLASH_WRITE(0x555, 0x56);
+		_FLASH_WRITE(0xAAA, 0x90);
+		data = _FLASH_READ(0) | ((u32)_FLASH_READ(2) << 16);
+		_FLASH_WRITE(0, 0xF0);
+	}
+	return data;
+}
+
+IWRAM_CODE BOOL FlashCheckType(u8 type)
 {
-	u32 data;
 	u16 ie = REG_IE;
 	REG_IE = ie & 0xFFFE;
+	u32 data = FlashReadId(type);
+	REG_IE = ie;
+
+	if ((type >= 1) && (type <= 3) && (data == flash_chips[type - 1].id))
+		return TRUE;
+	return FALSE;
+}
 
-	// 2G cart with 6600M0U0BE (369-in-1)
-	_FLASH_WRITE(0, 0xFF);
-	_FLASH_WRITE(0, 0x90);
-	data = *(vu32 *)AGB_ROM;
-	_FLASH_WRITE(0, 0xFF);
-	if (data == 0x88B0008A)
+u32 FlashGetSectorSize(u8 type)
+{
+	if ((type >= 1) && (type <= 3))
+		return flash_chips[type - 1].sector_size;
+	return 0x20000;
+}
+
+u32 FlashGetBufferSize(u8 type)
+{
+	if ((type >= 1) && (type <= 3))
+		return flash_chips[type - 1].buffer_size;
+	return FLASH_BUFFER_SIZE_MAX;
+}
+
+IWRAM_CODE void FlashDetectType(void)
+{
+	u8 type;
+	for (type = 1; type <= 3; type++)
 	{
-		REG_IE = ie;
-		flash_type = 1;
-		flash_sector_size = 0x40000;
-		FlashCalcOffsets();
-		return;
+		if (FlashCheckType(type))
+			break;
 	}
+	if (type > 3)
+		type = 0; // Unknown type
+
+	flash_type = type;
+	flash_sector_size = FlashGetSectorSize(type);
+	flash_buffer_size = FlashGetBufferSize(type);
+	FlashCalcOffsets();
+}
 
-	// 512M cart with MSP55LV100S (Zelda Classic Collection 7-in-1)
-	_FLASH_WRITE(0, 0xF0F0);
-	_FLASH_WRITE(0xAAA, 0xAAA9);
-	_FLASH_WRITE(0x555, 0x5556);
-	_FLASH_WRITE(0xAAA, 0x9090);
-	data = *(vu32 *)AGB_ROM;
-	_FLASH_WRITE(0, 0xF0F0);
-	if (data == 0x7E7D0102)
+IWRAM_CODE u32 FlashTimerRead(void)
+{
+	u16 hi = REG_TM1CNT_L;
+	u16 lo = REG_TM0CNT_L;
+	if (hi != REG_TM1CNT_L)
 	{
-		REG_IE = ie;
-		flash_type = 2;
-		flash_sector_size = 0x20000;
-		FlashCalcOffsets();
-		return;
+		hi = REG_TM1CNT_L;
+		lo = REG_TM0CNT_L;
 	}
+	return (hi << 16) | lo;
+}
 
-	// 1G cart with MSP54LV100S (Zelda Classic Collection 7-in-1)
-	_FLASH_WRITE(0, 0xF0);
-	_FLASH_WRITE(0xAAA, 0xA9);
-	_FLASH_WRITE(0x555, 0x56);
-	_FLASH_WRITE(0xAAA, 0x90);
-	data = *(vu32 *)AGB_ROM;
-	_FLASH_WRITE(0, 0xF0);
-	if (data == 0x227D0002)
+static void FlashWearInit(void)
+{
+	// Timers 0 and 1 run freely from here on and time every erase and program operation
+	REG_TM0CNT_H = 0;
+	REG_TM1CNT_H = 0;
+	REG_TM0CNT_L = 0;
+	REG_TM1CNT_L = 0;
+	REG_TM1CNT_H = 0x0084; // count up on timer 0 overflow
+	REG_TM0CNT_H = 0x0081; // 16.78 MHz / 64
+
+	// The record only counts if it was taken on this chip
+	u32 status_address = flash_status_sector_offset * flash_sector_size;
+	memcpy(&flash_wear, (void *)(AGB_ROM + status_address + FLASH_WEAR_OFFSET), sizeof(FlashWear));
+	if ((flash_wear.magic != MAGIC_FLASH_WEAR) || (flash_wear.version != FLASH_WEAR_VERSION) || (flash_wear.flash_type != flash_type))
 	{
-		REG_IE = ie;
-		flash_type = 3;
-		flash_sector_size = 0x20000;
+		memset(&flash_wear, 0, sizeof(FlashWear));
+	}
+	flash_wear.magic = MAGIC_FLASH_WEAR;
+	flash_wear.version = FLASH_WEAR_VERSION;
+	flash_wear.flash_type = flash_type;
+}
+
+void FlashInit(FlashStatus *status)
+{
+	// The last game launch caches the chip type in the status record. Its location depends on the
+	// sector size, so both geometries are tried; a hit only needs one ID read instead of probing every chip.
+	for (u32 sector_size = 0x40000; sector_size >= 0x20000; sector_size >>= 1)
+	{
+		flash_sector_size = sector_size;
 		FlashCalcOffsets();
-		return;
+		memcpy(status, (void *)(AGB_ROM + flash_status_sector_offset * flash_sector_size), sizeof(FlashStatus));
+		if (status->magic != MAGIC_FLASH_STATUS)
+			continue;
+		if ((status->flash_type == 0) || (status->flash_type > 3) || (status->flash_type_check != (u8)~status->flash_type))
+			continue;
+		if (FlashGetSectorSize(status->flash_type) != sector_size)
+			continue;
+		if (FlashCheckType(status->flash_type))
+		{
+			flash_type = status->flash_type;
+			flash_buffer_size = FlashGetBufferSize(flash_type);
+			FlashWearInit();
+			return;
+		}
+		break;
 	}
 
-	// Unknown type
-	REG_IE = ie;
-	flash_type = 0;
-	flash_sector_size = 0x20000;
-	FlashCalcOffsets();
-	return;
+	FlashDetectType();
+	memcpy(status, (void *)(AGB_ROM + flash_status_sector_offset * flash_sector_size), sizeof(FlashStatus));
+	FlashWearInit();
 }
 
-IWRAM_CODE void FlashEraseSector(u32 address)
+// ROM waitstate settings to try, fastest first (first/second access of WS0, prefetch buffer on)
+const u16 rom_waitcnt_candidates[] = {
+	0x4018, // 2/1
+	0x4014, // 3/1
+	0x4004, // 3/2
+	0x4000, // 4/2
+};
+
+IWRAM_CODE static u32 RomChecksum(void)
 {
-	if (flash_type == 0)
+	// Sequential reads through the menu's code followed by scattered single reads over the whole menu ROM
+	u32 sum = 0;
+	u32 own_size = (u32)(&__rom_end__) - 0x8000000;
+	for (u32 i = 0; i < 0x2000; i += 4)
 	{
-		FlashDetectType();
+		sum = ((sum << 1) | (sum >> 31)) ^ *(vu32 *)(AGB_ROM + i);
 	}
-	vu8 _flash_type = flash_type;
-	vu16 ie = REG_IE;
+	for (u32 i = 0; i < own_size; i += 0x402)
+	{
+		sum = ((sum << 1) | (sum >> 31)) ^ *(vu16 *)(AGB_ROM + i);
+	}
+	return sum;
+}
+
+IWRAM_CODE static BOOL RomWaitstateTest(u16 waitcnt, u32 reference)
+{
+	u16 ie = REG_IE;
 	REG_IE = ie & 0xFFFE;
+	REG_WAITCNT = (rom_waitcnt_default & ~0x401C) | waitcnt;
+	BOOL ok = TRUE;
+	for (u8 i = 0; i < 4; i++)
+	{
+		if (RomChecksum() != reference)
+		{
+			ok = FALSE;
+			break;
+		}
+	}
+	if (!ok)
+		REG_WAITCNT = rom_waitcnt_default;
+	REG_IE = ie;
+	return ok;
+}
 
-	if (_flash_type == 1)
+void FlashTuneWaitstates(FlashStatus *status)
+{
+	rom_waitcnt_default = REG_WAITCNT;
+	rom_waitcnt = rom_waitcnt_default;
+	u32 reference = RomChecksum();
+
+	// Setting that worked on this chip before, stored with bit 15 set by the last game launch
+	if ((flash_type != 0) && (status->flash_type == flash_type) && (status->rom_waitcnt & 0x8000))
+	{
+		if (RomWaitstateTest(status->rom_waitcnt & 0x7FFF, reference))
+		{
+			rom_waitcnt = REG_WAITCNT;
+			return;
+		}
+	}
+
+	for (u8 i = 0; i < sizeof(rom_waitcnt_candidates) / sizeof(rom_waitcnt_candidates[0]); i++)
+	{
+		if (RomWaitstateTest(rom_waitcnt_candidates[i], reference))
+		{
+			rom_waitcnt = REG_WAITCNT;
+			return;
+		}
+	}
+}
+
+IWRAM_CODE static void FlashEraseStart(u8 type, u32 address)
+{
+	if (type == 1)
 	{
 		_FLASH_WRITE(address, 0xFF);
 		_FLASH_WRITE(address, 0x60);
 		_FLASH_WRITE(address, 0xD0);
 		_FLASH_WRITE(address, 0x20);
 		_FLASH_WRITE(address, 0xD0);
-		while (1)
-		{
-			__asm("nop");
-			if ((*((vu16 *)(AGB_ROM + address)) & 0x80) == 0x80)
-			{
-				break;
-			}
-		}
-		_FLASH_WRITE(address, 0xFF);
 	}
-	else if (_flash_type == 2)
+	else if (type == 2)
 	{
 		_FLASH_WRITE(0xAAA, 0xAAA9);
 		_FLASH_WRITE(0x555, 0x5556);
@@ -126,17 +290,8 @@ IWRAM_CODE void FlashEraseSector(u32 address)
 		_FLASH_WRITE(0xAAA, 0xAAA9);
 		_FLASH_WRITE(0x555, 0x5556);
 		_FLASH_WRITE(address, 0x3030);
-		while (1)
-		{
-			__asm("nop");
-			if ((*((vu16 *)(AGB_ROM + address))) == 0xFFFF)
-			{
-				break;
-			}
-		}
-		_FLASH_WRITE(address, 0xF0F0);
 	}
-	else if (_flash_type == 3)
+	else if (type == 3)
 	{
 		_FLASH_WRITE(0xAAA, 0xA9);
 		_FLASH_WRITE(0x555, 0x56);
@@ -144,30 +299,74 @@ IWRAM_CODE void FlashEraseSector(u32 address)
 		_FLASH_WRITE(0xAAA, 0xA9);
 		_FLASH_WRITE(0x555, 0x56);
 		_FLASH_WRITE(address, 0x30);
-		while (1)
-		{
-			__asm("nop");
-			if ((*((vu16 *)(AGB_ROM + address))) == 0xFFFF)
-			{
-				break;
-			}
-		}
+	}
+}
+
+IWRAM_CODE static BOOL FlashEraseBusy(u8 type, u32 address)
+{
+	__asm("nop");
+	if (type == 1)
+	{
+		return (_FLASH_READ(address) & 0x80) != 0x80;
+	}
+	return _FLASH_READ(address) != 0xFFFF;
+}
+
+IWRAM_CODE static void FlashReset(u8 type, u32 address)
+{
+	if (type == 1)
+	{
+		_FLASH_WRITE(address, 0xFF);
+	}
+	else if (type == 2)
+	{
+		_FLASH_WRITE(address, 0xF0F0);
+	}
+	else if (type == 3)
+	{
 		_FLASH_WRITE(address, 0xF0);
 	}
+}
+
+IWRAM_CODE void FlashEraseSector(u32 address)
+{
+	if (flash_type == 0)
+	{
+		FlashDetectType();
+	}
+	vu8 _flash_type = flash_type;
+	vu16 ie = REG_IE;
+	REG_IE = ie & 0xFFFE;
+	u16 waitcnt = REG_WAITCNT;
+	REG_WAITCNT = rom_waitcnt_default;
+
+	if (_flash_type >= 1 && _flash_type <= 3)
+	{
+		u32 start = _READ_FLASH_TIMER();
+		FlashEraseStart(_flash_type, address);
+		while (FlashEraseBusy(_flash_type, address))
+			;
+		FlashReset(_flash_type, address);
+		flash_wear.erase_ticks += _READ_FLASH_TIMER() - start;
+		flash_wear.erase_count++;
+	}
 
+	REG_WAITCNT = waitcnt;
 	REG_IE = ie;
 }
 
-IWRAM_CODE void FlashWriteData(u32 address, u32 length)
+IWRAM_CODE void FlashWriteData(u32 address, u8 *data, u32 length)
 {
 	if (flash_type == 0)
 	{
 		FlashDetectType();
 	}
 	u8 _flash_type = flash_type;
-	vu16 *p_rom = (vu16 *)(AGB_ROM + address);
 	vu16 ie = REG_IE;
 	REG_IE = ie & 0xFFFE;
+	u16 waitcnt = REG_WAITCNT;
+	REG_WAITCNT = rom_waitcnt_default;
+	u32 start = _READ_FLASH_TIMER();
 
 	if (_flash_type == 1)
 	{
@@ -177,7 +376,7 @@ IWRAM_CODE void FlashWriteData(u32 address, u32 length)
 			while (1)
 			{
 				__asm("nop");
-				if ((p_rom[(j * 0x200)] & 0x80) == 0x80)
+				if ((_FLASH_READ(address + (j * 0x400)) & 0x80) == 0x80)
 				{
 					break;
 				}
@@ -185,13 +384,13 @@ IWRAM_CODE void FlashWriteData(u32 address, u32 length)
 			_FLASH_WRITE(address + (j * 0x400), 0x1FF);
 			for (int i = 0; i < 0x400; i += 2)
 			{
-				_FLASH_WRITE(address + (j * 0x400) + i, data_buffer[(j * 0x400) + i + 1] << 8 | data_buffer[(j * 0x400) + i]);
+				_FLASH_WRITE(address + (j * 0x400) + i, data[(j * 0x400) + i + 1] << 8 | data[(j * 0x400) + i]);
 			}
 			_FLASH_WRITE(address + (j * 0x400), 0xD0);
 			while (1)
 			{
 				__asm("nop");
-				if ((p_rom[(j * 0x200)] & 0x80) == 0x80)
+				if ((_FLASH_READ(address + (j * 0x400)) & 0x80) == 0x80)
 				{
 					break;
 				}
@@ -207,18 +406,18 @@ IWRAM_CODE void FlashWriteData(u32 address, u32 length)
 			_FLASH_WRITE(0x555, 0x5556);
 			_FLASH_WRITE(address + (j * 0x20), 0x2526);
 			_FLASH_WRITE(address + (j * 0x20), 0x0F0F);
-			u16 data = 0;
+			u16 word = 0;
 			for (int i = 0; i < 0x20; i += 2)
 			{
 				__asm("nop");
-				data = data_buffer[(j * 0x20) + i + 1] << 8 | data_buffer[(j * 0x20) + i];
-				_FLASH_WRITE(address + (j * 0x20) + i, data);
+				word = data[(j * 0x20) + i + 1] << 8 | data[(j * 0x20) + i];
+				_FLASH_WRITE(address + (j * 0x20) + i, word);
 			}
 			_FLASH_WRITE(address + (j * 0x20), 0x292A);
 			while (1)
 			{
 				__asm("nop");
-				if (p_rom[(j * 0x10) + 0x0F] == data)
+				if (_FLASH_READ(address + (j * 0x20) + 0x1E) == word)
 				{
 					break;
 				}
@@ -234,18 +433,18 @@ IWRAM_CODE void FlashWriteData(u32 address, u32 length)
 			_FLASH_WRITE(0x555, 0x56);
 			_FLASH_WRITE(address + (j * 0x40), 0x26);
 			_FLASH_WRITE(address + (j * 0x40), 0x1F);
-			u16 data = 0;
+			u16 word = 0;
 			for (int i = 0; i < 0x40; i += 2)
 			{
 				__asm("nop");
-				data = data_buffer[(j * 0x40) + i + 1] << 8 | data_buffer[(j * 0x40) + i];
-				_FLASH_WRITE(address + (j * 0x40) + i, data);
+				word = data[(j * 0x40) + i + 1] << 8 | data[(j * 0x40) + i];
+				_FLASH_WRITE(address + (j * 0x40) + i, word);
 			}
 			_FLASH_WRITE(address + (j * 0x40), 0x2A);
 			while (1)
 			{
 				__asm("nop");
-				if (p_rom[(j * 0x20) + 0x1F] == data)
+				if (_FLASH_READ(address + (j * 0x40) + 0x3E) == word)
 				{
 					break;
 				}
@@ -254,9 +453,130 @@ IWRAM_CODE void FlashWriteData(u32 address, u32 length)
 		_FLASH_WRITE(address, 0xF0);
 	}
 
+	if (_flash_type >= 1 && _flash_type <= 3)
+	{
+		flash_wear.program_ticks += _READ_FLASH_TIMER() - start;
+		flash_wear.program_count++;
+	}
+
+	REG_WAITCNT = waitcnt;
 	REG_IE = ie;
 }
 
+IWRAM_CODE static void FlashWearCountSave(u8 save_index)
+{
+	if (flash_wear.save_erases[save_index] != 0xFFFF)
+		flash_wear.save_erases[save_index]++;
+}
+
+void SaveRegisterBackup(void)
+{
+	// SRAM bytes 2~5 share their addresses with the mapper registers, so every mapper write (e.g. the bank
+	// switches of the verification mode) changes them; keep the game's values from before the first one
+	sram_register_backup[0] = *(vu8 *)MAPPER_CONFIG1;
+	sram_register_backup[1] = *(vu8 *)MAPPER_CONFIG2;
+	sram_register_backup[2] = *(vu8 *)MAPPER_CONFIG3;
+	sram_register_backup[3] = *(vu8 *)MAPPER_CONFIG4;
+}
+
+IWRAM_CODE void SaveWriteBackStart(FlashStatus *status)
+{
+	if (sSaveWriteBack.state != WRITEBACK_IDLE)
+		return;
+	if (!status->battery_present)
+		return;
+	if (flash_type == 0)
+	{
+		FlashDetectType();
+		if (flash_type == 0)
+			return;
+	}
+	u32 length = GetSaveSize(status->last_boot_save_type);
+	if (length == 0)
+		return;
+
+	sSaveWriteBack.address = (flash_save_sector_offset + status->last_boot_save_index) * flash_sector_size;
+	sSaveWriteBack.length = length;
+	sSaveWriteBack.position = 0;
+	sSaveWriteBack.save_index = status->last_boot_save_index;
+	sSaveWriteBack.state = WRITEBACK_COMPARE;
+}
+
+IWRAM_CODE static void SaveReadChunk(u32 position, u32 length)
+{
+	// Copies part of the previous game's SRAM into the write buffer, with the bytes at the mapper registers as they were on boot
+	*(vu8 *)MAPPER_CONFIG4 = 1;
+	for (u32 i = 0; i < length; i++)
+	{
+		data_buffer[i] = ((vu8 *)AGB_SRAM)[position + i];
+	}
+	*(vu8 *)MAPPER_CONFIG4 = 0;
+	if (position == 0)
+	{
+		data_buffer[2] = sram_register_backup[0];
+		data_buffer[3] = sram_register_backup[1];
+		data_buffer[4] = sram_register_backup[2];
+		data_buffer[5] = sram_register_backup[3];
+	}
+}
+
+IWRAM_CODE BOOL SaveWriteBackStep(void)
+{
+	u32 position = sSaveWriteBack.position;
+
+	switch (sSaveWriteBack.state)
+	{
+	case WRITEBACK_COMPARE:
+		// A save that still matches its slot doesn't need to be written again. The erase of a changed one is left
+		// to BootGame(): the menu runs from the flash chip, so it would stand still for the whole erase.
+		for (u32 i = position; i < position + SAVE_WRITEBACK_CHUNK_SIZE; i += flash_buffer_size)
+		{
+			SaveReadChunk(i, flash_buffer_size);
+			if (memcmp(data_buffer, (void *)(AGB_ROM + sSaveWriteBack.address + i), flash_buffer_size) != 0)
+			{
+				sSaveWriteBack.position = 0;
+				sSaveWriteBack.state = WRITEBACK_ERASE;
+				return FALSE;
+			}
+		}
+		position += SAVE_WRITEBACK_CHUNK_SIZE;
+		if (position >= sSaveWriteBack.length)
+		{
+			sSaveWriteBack.state = WRITEBACK_DONE;
+		}
+		break;
+
+	case WRITEBACK_PROGRAM:
+		// SRAM is streamed to flash one write buffer at a time
+		for (u32 i = position; i < position + SAVE_WRITEBACK_CHUNK_SIZE; i += flash_buffer_size)
+		{
+			SaveReadChunk(i, flash_buffer_size);
+			FlashWriteData(sSaveWriteBack.address + i, data_buffer, flash_buffer_size);
+		}
+		position += SAVE_WRITEBACK_CHUNK_SIZE;
+		if (position >= sSaveWriteBack.length)
+		{
+			sSaveWriteBack.state = WRITEBACK_DONE;
+		}
+		break;
+
+	default:
+		return FALSE;
+	}
+
+	sSaveWriteBack.position = position;
+	return sSaveWriteBack.state != WRITEBACK_DONE;
+}
+
+IWRAM_CODE void SaveWriteBackCancel(void)
+{
+	// Nothing has been erased yet, so the job can simply be dropped
+	if ((sSaveWriteBack.state == WRITEBACK_COMPARE) || (sSaveWriteBack.state == WRITEBACK_ERASE))
+	{
+		sSaveWriteBack.state = WRITEBACK_DONE;
+	}
+}
+
 IWRAM_CODE void DrawBootStatusLine(u8 begin, u8 end)
 {
 	for (int i = begin; i < end; i++)
@@ -265,76 +585,137 @@ IWRAM_CODE void DrawBootStatusLine(u8 begin, u8 end)
 	}
 }
 
+IWRAM_CODE static void BootFadeStep(void)
+{
+	// One brightness step at the start of each VBlank; polled because the VBlank interrupt stays masked while the chip is busy
+	BOOL vblank = _READ_VCOUNT() >= 160;
+	if (vblank && !boot_fade_vblank && boot_fade_level < 17)
+	{
+		REG_BLDY = boot_fade_level++;
+	}
+	boot_fade_vblank = vblank;
+}
+
+IWRAM_CODE static void BootEraseSector(u8 type, u32 address)
+{
+	// Erases a sector while the fade goes on
+	u32 start = _READ_FLASH_TIMER();
+	FlashEraseStart(type, address);
+	while (FlashEraseBusy(type, address))
+		BootFadeStep();
+	FlashReset(type, address);
+	flash_wear.erase_ticks += _READ_FLASH_TIMER() - start;
+	flash_wear.erase_count++;
+}
+
 IWRAM_CODE u8 BootGame(ItemConfig config, FlashStatus status)
 {
 	u32 _flash_sector_size = flash_sector_size;
 	u32 _flash_save_block_offset = flash_save_sector_offset;
 	u32 _flash_status_block_offset = flash_status_sector_offset;
+	u32 _save_size = GetSaveSize(config.save_type);
+	u32 _status_address = _flash_status_block_offset * _flash_sector_size;
 
-	// Check if supported flash chip is present
-	FlashDetectType();
+	// Games expect the waitstate settings the BIOS left behind
+	REG_WAITCNT = rom_waitcnt_default;
+
+	// Check if supported flash chip is present (already verified on boot if it was cached)
+	if (flash_type == 0)
+		FlashDetectType();
 	u8 _flash_type = flash_type;
 	if (_flash_type == 0)
+	{
+		REG_TM0CNT = 0;
+		REG_TM1CNT = 0;
 		return 1;
+	}
 
-	// Temporarily store SRAM values located at mapper registers
-	sram_register_backup[0] = *(vu8 *)MAPPER_CONFIG1;
-	sram_register_backup[1] = *(vu8 *)MAPPER_CONFIG2;
-	sram_register_backup[2] = *(vu8 *)MAPPER_CONFIG3;
-	sram_register_backup[3] = *(vu8 *)MAPPER_CONFIG4;
+	// Fade out while the flash chip is being erased and programmed
+	REG_IE = REG_IE & 0xFFFE;
+	REG_BLDCNT = 0x00FF;
+	boot_fade_level = 0;
+	boot_fade_vblank = TRUE;
 
-	// Enable SRAM access
-	*(vu8 *)MAPPER_CONFIG4 = 1;
+	// Write previous SRAM to flash unless it still matches the save slot; the menu may have compared part of it already
+	SaveWriteBackStart(&status);
 
-	// Write previous SRAM to flash
-	if (status.battery_present)
+	while (sSaveWriteBack.state == WRITEBACK_COMPARE)
 	{
-		if (status.last_boot_save_type != SRAM_NONE)
-		{
-			for (int i = 0; i < SRAM_SIZE; i++)
-			{
-				data_buffer[i] = ((vu8 *)AGB_SRAM)[i];
-			}
-			data_buffer[2] = sram_register_backup[0];
-			data_buffer[3] = sram_register_backup[1];
-			data_buffer[4] = sram_register_backup[2];
-			data_buffer[5] = sram_register_backup[3];
-			FlashEraseSector((_flash_save_block_offset + status.last_boot_save_index) * _flash_sector_size);
-			FlashWriteData((_flash_save_block_offset + status.last_boot_save_index) * _flash_sector_size, SRAM_SIZE);
-		}
+		SaveWriteBackStep();
+		BootFadeStep();
+	}
+	if (sSaveWriteBack.state == WRITEBACK_ERASE)
+	{
+		BootEraseSector(_flash_type, sSaveWriteBack.address);
+		FlashWearCountSave(sSaveWriteBack.save_index);
+		sSaveWriteBack.state = WRITEBACK_PROGRAM;
 	}
+	while (SaveWriteBackStep())
+		BootFadeStep();
+
+	// The old status record stays valid until the save is fully programmed, so a power loss before this point
+	// makes the next boot write the still intact SRAM back again
+	BootEraseSector(_flash_type, _status_address);
+	flash_wear.status_erases++;
+
+	// Enable SRAM access
+	*(vu8 *)MAPPER_CONFIG4 = 1;
 
 	// Save status to flash
 	status.last_boot_save_index = config.save_index;
 	status.last_boot_save_type = config.save_type;
-	memset((void *)data_buffer, 0, 0x1000);
+	status.last_boot_list_start = itemlist_start;
+	status.flash_type = _flash_type;
+	status.flash_type_check = ~_flash_type;
+	status.rom_waitcnt = rom_waitcnt | 0x8000;
+	memset((void *)data_buffer, 0, flash_buffer_size);
 	memcpy(data_buffer, &status, sizeof(status));
-	FlashEraseSector(_flash_status_block_offset * flash_sector_size);
-	FlashWriteData(_flash_status_block_offset * flash_sector_size, 0x1000);
-
-	// Disable SRAM access
-	*(vu8 *)MAPPER_CONFIG4 = 0;
-
-	// Read new SRAM from flash
-	if (config.save_type != SRAM_NONE)
+	FlashWriteData(_status_address, data_buffer, flash_buffer_size);
+
+	// Save the wear record into the same freshly erased sector; it includes everything up to the status write
+	flash_wear.magic = MAGIC_FLASH_WEAR;
+	flash_wear.version = FLASH_WEAR_VERSION;
+	flash_wear.flash_type = _flash_type;
+	u32 wear_length = (sizeof(FlashWear) + flash_buffer_size - 1) & ~(flash_buffer_size - 1);
+	memset((void *)data_buffer, 0xFF, wear_length);
+	memcpy(data_buffer, &flash_wear, sizeof(FlashWear));
+	FlashWriteData(_status_address + FLASH_WEAR_OFFSET, data_buffer, wear_length);
+
+	// Copy new save data from flash to SRAM; the bytes at the mapper registers can only be written once the mapper is locked
+	u8 save_register_bytes[4];
+	if (_save_size > 0)
 	{
-		for (int i = 0; i < SRAM_SIZE; i += 2)
+		vu16 *save = (vu16 *)(AGB_ROM + (_flash_save_block_offset + config.save_index) * _flash_sector_size);
+		for (int i = 0; i < (int)_save_size; i += 2)
 		{
-			data_buffer[i] = *((vu16 *)(AGB_ROM + ((_flash_save_block_offset + config.save_index) * _flash_sector_size) + i)) & 0xFF;
-			data_buffer[i + 1] = *((vu16 *)(AGB_ROM + ((_flash_save_block_offset + config.save_index) * _flash_sector_size) + i)) >> 8;
+			u16 word = save[i >> 1];
+			if ((i >= 2) && (i < 6))
+			{
+				save_register_bytes[i - 2] = word & 0xFF;
+				save_register_bytes[i - 1] = word >> 8;
+			}
+			else
+			{
+				((vu8 *)AGB_SRAM)[i] = word & 0xFF;
+				((vu8 *)AGB_SRAM)[i + 1] = word >> 8;
+			}
+			if ((i & 0xFFF) == 0)
+				BootFadeStep();
 		}
 	}
 
-	// Fade out
-	REG_BLDCNT = 0x00FF;
-	for (u8 i = 0; i < 17; i++)
-	{
-		REG_BLDY = i;
-		SystemCall(5);
-	}
+	// Disable SRAM access
+	*(vu8 *)MAPPER_CONFIG4 = 0;
+
+	// Finish the fade
+	while (boot_fade_level < 17)
+		BootFadeStep();
 
-	// Disable interrupts
+	// Disable interrupts, the menu's HBlank DMA and the flash timers; games expect stopped timers
 	REG_IE = 0;
+	REG_DMA0CNT = 0;
+	REG_TM0CNT = 0;
+	REG_TM1CNT = 0;
 
 	// Set mapper configuration
 	*(vu8 *)MAPPER_CONFIG1 = ((config.rom_offset / 0x40) & 0xF) << 4; // flash bank (0~7)
@@ -357,12 +738,12 @@ IWRAM_CODE u8 BootGame(ItemConfig config, FlashStatus status)
 	// Lock mapper
 	*(vu8 *)MAPPER_CONFIG2 |= 0x80;
 
-	// Write buffer to SRAM
-	if (config.save_type != SRAM_NONE)
+	// Write the rest of the save data to SRAM
+	if (_save_size > 0)
 	{
-		for (int i = 0; i < SRAM_SIZE; i++)
+		for (int i = 0; i < 4; i++)
 		{
-			((vu8 *)AGB_SRAM)[i] = data_buffer[i];
+			((vu8 *)AGB_SRAM)[2 + i] = save_register_bytes[i];
 		}
 	}
 	else
@@ -381,7 +762,7 @@ IWRAM_CODE u8 BootGame(ItemConfig config, FlashStatus status)
 	REG_BLDY = 0;
 
 	// Boot ROM
-	__asm("swi 0"); // Soft reset
+	_SOFT_RESET();
 
 	return 3;
 }
@@ -8,11 +8,30 @@ Author: Lesserkuma (github.com/lesserkuma)
 
 #include "main.h"
 
+// Bus access hooks, can be overridden by host-side builds (see tools/flash_sim)
+#ifndef _FLASH_WRITE
 #define _FLASH_WRITE(pa, pd)                     \
     {                                            \
         *(((vu16 *)AGB_ROM) + ((pa) >> 1)) = pd; \
         __asm("nop");                            \
     }
+#endif
+
+#ifndef _FLASH_READ
+#define _FLASH_READ(pa) (*((vu16 *)(AGB_ROM + (pa))))
+#endif
+
+#ifndef _READ_VCOUNT
+#define _READ_VCOUNT() REG_VCOUNT
+#endif
+
+#ifndef _SOFT_RESET
+#define _SOFT_RESET() __asm("swi 0")
+#endif
+
+#ifndef _READ_FLASH_TIMER
+#define _READ_FLASH_TIMER() FlashTimerRead()
+#endif
 
 #define MAGIC_FLASH_STATUS 0x414D554B
 
@@ -24,11 +43,78 @@ typedef struct __attribute__((packed)) FlashStatus_
     u16 last_boot_menu_index;
     u8 last_boot_save_index;
     SAVE_TYPE last_boot_save_type;
+    u8 flash_type;       // cached chip type, 0 if unknown
+    u8 flash_type_check; // inverted flash_type
+    u16 last_boot_list_start; // first item of the list shown at the last boot
+    u16 rom_waitcnt; // bit 15 set if it was tuned for this chip
 } FlashStatus;
 
+#define MAGIC_FLASH_WEAR 0x52574B4C       // "LKWR"
+#define FLASH_WEAR_VERSION 1
+#define FLASH_WEAR_OFFSET 0x400     // within the status sector, behind the status record's write buffer
+#define FLASH_WEAR_SAVE_SLOTS 256
+#define FLASH_TIMER_HZ 262144 // 16.78 MHz / 64
+
+// Erase counts and flash operation timings. The status sector is erased on every game launch anyway,
+// so the record is programmed right behind the new status record and never needs an erase of its own.
+typedef struct __attribute__((packed)) FlashWear_
+{
+    u32 magic;
+    u8 version;
+    u8 flash_type; // chip the timings were taken on
+    u16 reserved;
+    u32 erase_count;   // sectors erased, also by FlashEraseSector() calls outside the status and save sectors
+    u32 program_count; // FlashWriteData() calls
+    u64 erase_ticks;   // FLASH_TIMER_HZ
+    u64 program_ticks;
+    u32 status_erases;
+    u16 save_erases[FLASH_WEAR_SAVE_SLOTS]; // stops at 0xFFFF
+} FlashWear;
+
+typedef struct FlashChip_
+{
+    u32 id;          // manufacturer and device ID as read by FlashReadId()
+    u32 sector_size;
+    u16 buffer_size; // bytes per buffered program operation
+} FlashChip;
+
+#define FLASH_BUFFER_SIZE_MAX 0x400
+
+#define SAVE_WRITEBACK_CHUNK_SIZE 0x1000
+#define SAVE_WRITEBACK_IDLE_FRAMES 30
+
+typedef enum
+{
+    WRITEBACK_IDLE,
+    WRITEBACK_COMPARE,
+    WRITEBACK_ERASE,
+    WRITEBACK_PROGRAM,
+    WRITEBACK_DONE
+} WRITEBACK_STATE;
+
+typedef struct SaveWriteBack_
+{
+    WRITEBACK_STATE state;
+    u32 address;
+    u32 length;
+    u32 position;
+    u8 save_index;
+} SaveWriteBack;
+
+IWRAM_CODE u32 FlashTimerRead(void);
+IWRAM_CODE u32 GetSaveSize(SAVE_TYPE save_type);
+IWRAM_CODE BOOL FlashCheckType(u8 type);
+u32 FlashGetSectorSize(u8 type);
+u32 FlashGetBufferSize(u8 type);
 IWRAM_CODE void FlashDetectType(void);
+void FlashInit(FlashStatus *status);
+void FlashTuneWaitstates(FlashStatus *status);
 IWRAM_CODE void FlashEraseSector(u32 address);
-IWRAM_CODE void FlashWriteData(u32 address, u32 length);
+IWRAM_CODE void FlashWriteData(u32 address, u8 *data, u32 length);
+void SaveRegisterBackup(void);
+IWRAM_CODE void SaveWriteBackStart(FlashStatus *status);
+IWRAM_CODE BOOL SaveWriteBackStep(void);
+IWRAM_CODE void SaveWriteBackCancel(void);
 IWRAM_CODE u8 BootGame(ItemConfig config, FlashStatus status);
 
 #endif
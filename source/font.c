@@ -10,11 +10,7 @@ Author: Lesserkuma (github.com/lesserkuma)
 #include "font.h"
 
 FontSpecs sFontSpecs;
-NFTR_Header sNFTR_Header;
-FINF_Header sFINF_Header;
-CGLP_Header sCGLP_Header;
-CWDH_Header sCWDH_Header;
-CMAP_Header sCMAP_Header;
+FontHeader sFontHeader;
 
 u16 FallbackCharacter;
 u16 ArrowCharacter;
@@ -26,14 +22,14 @@ const u8* font;
 
 void LoadFont(u8 index) {
 	if (index != last_font) {
-		font = font_nftr;
+		font = font_lkfn;
 		FallbackCharacter = 0x2753;
 		ArrowCharacter = 0x21E8;
 		FontMarginTop = 0;
 		FontMarginBottom = 0;
 #ifdef FONT_NTR_IPL
 		if (index == 1) {
-			font = NTR_IPL_font_s_nftr;
+			font = NTR_IPL_font_s_lkfn;
 			FallbackCharacter = 0xE011;
 			ArrowCharacter = 0xE019;
 			FontMarginTop = 2;
@@ -42,7 +38,7 @@ void LoadFont(u8 index) {
 #endif
 #ifdef FONT_TBF1
 		if (index == 2) {
-			font = TBF1_s_nftr;
+			font = TBF1_s_lkfn;
 			FallbackCharacter = 0xE011;
 			ArrowCharacter = 0xE019;
 			FontMarginTop = 1;
@@ -51,7 +47,7 @@ void LoadFont(u8 index) {
 #endif
 #ifdef FONT_TBF1_CN
 		if (index == 3) {
-			font = TBF1_cn_s_nftr;
+			font = TBF1_cn_s_lkfn;
 			FallbackCharacter = 0xE011;
 			ArrowCharacter = 0xE019;
 			FontMarginTop = 2;
@@ -60,7 +56,7 @@ void LoadFont(u8 index) {
 #endif
 #ifdef FONT_TBF1_KR
 		if (index == 4) {
-			font = TBF1_kr_s_nftr;
+			font = TBF1_kr_s_lkfn;
 			FallbackCharacter = 0xE011;
 			ArrowCharacter = 0xE019;
 			FontMarginTop = 2;
@@ -69,87 +65,58 @@ void LoadFont(u8 index) {
 #endif
 #ifdef FONT_TWL_IRAJ_1
 		if (index == 5) {
-			font = TWL_IRAJ_1_nftr;
+			font = TWL_IRAJ_1_lkfn;
 			FallbackCharacter = 0xFF1F;
 			ArrowCharacter = 0x2192;
 			FontMarginTop = 4;
 			FontMarginBottom = 6;
 		}
 #endif
-		LoadNFTR(font);
+		LoadFontData(font);
 		last_font = index;
 	}
 }
 
-void LoadNFTR(const u8* nftr_data) {
-	u32 pos = 0;
-	memcpy(&sNFTR_Header, nftr_data+pos, sizeof(sNFTR_Header));
-	pos += sNFTR_Header.size;
-	memcpy(&sFINF_Header, nftr_data+pos, sizeof(sFINF_Header));
-	pos += sFINF_Header.size;
-	memcpy(&sCGLP_Header, nftr_data+pos, sizeof(sCGLP_Header));
-	sFontSpecs.cglp_offset = pos;
-	pos = sFINF_Header.offset_CWDH - 8;
-	memcpy(&sCWDH_Header, nftr_data+pos, sizeof(sCWDH_Header));
-	sFontSpecs.cwdh_offset = pos + 16;
-	pos = sFINF_Header.offset_CMAP - 8;
-	memcpy(&sCMAP_Header, nftr_data+pos, sizeof(sCMAP_Header));
-	sFontSpecs.cmap_offset = pos;
-	sFontSpecs.nftr_version = sNFTR_Header.version;
-	sFontSpecs.max_width = sCGLP_Header.max_width;
-	sFontSpecs.max_height = sCGLP_Header.max_height;
-	sFontSpecs.bytes_per_char = sCGLP_Header.bytes_per_char;
-	sFontSpecs.num_of_chars = sCWDH_Header.num_of_chars;
-	sFontSpecs.bpp = sCGLP_Header.bpp;
+void LoadFontData(const u8* font_data) {
+	memcpy(&sFontHeader, font_data, sizeof(sFontHeader));
+	_TRACE_ROM_READ(sizeof(sFontHeader));
+	sFontSpecs.pages_offset = sFontHeader.pages_offset;
+	sFontSpecs.map_offset = sFontHeader.map_offset;
+	sFontSpecs.glyphs_offset = sFontHeader.glyphs_offset;
+	sFontSpecs.num_of_chars = sFontHeader.glyph_count;
+	sFontSpecs.max_width = sFontHeader.max_width;
+	sFontSpecs.max_height = sFontHeader.max_height;
+	sFontSpecs.bpp = sFontHeader.bpp;
+	sFontSpecs.row_size = sFontHeader.row_size;
+	sFontSpecs.glyph_size = sFontHeader.glyph_size;
 }
 
-u16 GetFontIndex(u16 ch, const u8* nftr_data) {
-	u32 pos = sFontSpecs.cmap_offset;
-	while (TRUE) {
-		if (pos <= 0) return 0xFFFF;
-		CMAP_Header tCMAP_Header;
-		memcpy(&tCMAP_Header, nftr_data+pos, sizeof(tCMAP_Header));
-		pos += 20;
-		
-		if (ch < tCMAP_Header.start_code || ch > tCMAP_Header.end_code) {
-			// CMAP doesn't have this character
-			pos = tCMAP_Header.next_offset - 8;
-			continue;
-		}
-		
-		if (tCMAP_Header.type == 0) {
-			u16 index_offset = nftr_data[pos+1] << 8 | nftr_data[pos];
-			return ch - tCMAP_Header.start_code + index_offset;
-		} else if (tCMAP_Header.type == 1) {
-			u16 utf16le_index = tCMAP_Header.start_code;
-			for (u16 i = tCMAP_Header.start_code; i < tCMAP_Header.end_code; i++) {
-				u16 font_index = nftr_data[pos+1] << 8 | nftr_data[pos];
-				pos += 2;
-				if (utf16le_index == ch) return font_index;
-				utf16le_index += 1;
-			}
-		} else if (tCMAP_Header.type == 2) {
-			u16 index_offset = nftr_data[pos+1] << 8 | nftr_data[pos];
-			pos += 2;
-			for (u16 i = 0; i < index_offset; i++) {
-				u16 utf16le_index = nftr_data[pos+1] << 8 | nftr_data[pos];
-				pos += 2;
-				u16 font_index = nftr_data[pos+1] << 8 | nftr_data[pos];
-				pos += 2;
-				if (utf16le_index == ch) return font_index;
-				utf16le_index += 1;
-			}
-		}
-		return 0xFFFF;
-	}
+RENDER_CODE u16 GetFontIndex(u16 ch, const u8* font_data) {
+	// Flattened character map: one lookup for the page, one for the glyph
+	u16 page = ((const u16*)(font_data + sFontSpecs.pages_offset))[ch >> 8];
+	_TRACE_ROM_READ(2);
+	if (page == 0xFFFF) return 0xFFFF;
+	_TRACE_ROM_READ(2);
+	return ((const u16*)(font_data + sFontSpecs.map_offset))[(page << 8) | (ch & 0xFF)];
+}
+
+RENDER_CODE void GetFontWidths(u16 index, const u8* font_data, u8* width, u8* advance) {
+	const FontGlyph* glyph = (const FontGlyph*)(font_data + sFontSpecs.glyphs_offset + index * sFontSpecs.glyph_size);
+	_TRACE_ROM_READ(2);
+	*width = glyph->width;
+	*advance = glyph->advance;
 }
 
-void GetFontWidths(u16 index, const u8* nftr_data, u8* a, u8* b, u8* c) {
-	u32 pos = sFontSpecs.cwdh_offset;
-	pos = pos + (index * 3);
-	*a = nftr_data[pos++];
-	*b = nftr_data[pos++];
-	*c = nftr_data[pos++];
+u8 GetGlyphWidth(u16 ch, const u8* font_data) {
+	// Horizontal advance of a single character, as used by DrawText
+	u8 width, advance;
+	u16 index = GetFontIndex(ch, font_data);
+	if (index == 0xFFFF) {
+		index = GetFontIndex(FallbackCharacter, font_data);
+		if (index == 0xFFFF) return 0;
+	}
+	GetFontWidths(index, font_data, &width, &advance);
+	return advance;
 }
 
 void AsciiToUnicode(char* text, u16* output) {
@@ -159,25 +126,38 @@ void AsciiToUnicode(char* text, u16* output) {
 	}
 }
 
-void DrawText(u8 px, u8 py, u8 align, u16* text, u8 length, const u8* nftr_data, volatile void* vram, BOOL highlighted) {
+RENDER_CODE static void DrawGlyphRow(volatile u16* line, u8 x, u32 mask, u32 plane0, u32 plane1, u8 color) {
+	// Pixels are written in pairs; a pair with only one glyph pixel keeps the other one
+	volatile u16* pair = line + (x >> 1);
+	mask <<= x & 1;
+	plane0 <<= x & 1;
+	plane1 <<= x & 1;
+	for (; mask != 0; mask >>= 2, plane0 >>= 2, plane1 >>= 2, pair++) {
+		if ((mask & 3) == 0) continue;
+		u16 value = ((mask & 3) == 3) ? 0 : *pair;
+		if (mask & 1) value = (value & 0xFF00) | (u8)(color + (plane0 & 1) + ((plane1 & 1) << 1));
+		if (mask & 2) value = (value & 0x00FF) | ((u8)(color + ((plane0 >> 1) & 1) + (plane1 & 2)) << 8);
+		*pair = value;
+		_TRACE_VRAM_WRITE(pair, 2);
+	}
+}
+
+RENDER_CODE void DrawText(u8 px, u8 py, u8 align, u16* text, u8 length, const u8* font_data, volatile void* vram, BOOL highlighted) {
 	u8 pos_left = 0;
 	u8 glyph_width = 0;
-	u8 glyph_left = 0;
-	u8 pixels[sFontSpecs.max_width * sFontSpecs.max_height];
+	u8 glyph_advance = 0;
 	u8 canvas[SCREEN_WIDTH * sFontSpecs.max_height];
-	u8 color_modifier = 0;
-	u32 offset = 0;
+	u8 color = (sFontSpecs.bpp == 1) ? 254 : 250; // 2 bpp glyphs add their color to this
+	u16 index = 0;
 	
 	py += FontMarginTop;
 
 	if (highlighted) {
-		color_modifier = 10;
+		color -= 10;
 	}
 	
 	memset(canvas, 255, SCREEN_WIDTH * sFontSpecs.max_height);
 	for (u8 i = 0; i < length; i++) {
-		u8 a, b, c = 0;
-		
 		u16 ch = text[i];
 		if (ch == 0x0000 || ch == 0xFFFF) {
 			break;
@@ -185,7 +165,7 @@ void DrawText(u8 px, u8 py, u8 align, u16* text, u8 length, const u8* nftr_data,
 		
 		BOOL last_ch = FALSE;
 		while (1) {
-			u16 index = GetFontIndex(ch, nftr_data);
+			index = GetFontIndex(ch, font_data);
 			if (index == 0xFFFF) { // character not found
 				ch = FallbackCharacter;
 				continue;
@@ -197,104 +177,40 @@ void DrawText(u8 px, u8 py, u8 align, u16* text, u8 length, const u8* nftr_data,
 					continue;
 				}
 			}
-			GetFontWidths(index, nftr_data, &a, &b, &c);
-			
-			offset = index * sFontSpecs.bytes_per_char;
-			glyph_left = a;
-			if (glyph_left >= sFontSpecs.max_width) glyph_left = 0;
-			if (ch == 32) { // space
-				glyph_left = 0;
-			}
-			
-			glyph_width = c - glyph_left;
+			GetFontWidths(index, font_data, &glyph_width, &glyph_advance);
 			break;
 		}
 		if (pos_left + glyph_width >= SCREEN_WIDTH - px) {
 			break;
 		}
-
-		if (b == 0) {
-			glyph_width = c;
-		}
-		if (sFontSpecs.nftr_version == 1) {
-			if (glyph_width == 0) glyph_width = sFontSpecs.max_width;
-			glyph_width += 1;
-		}
 		
-		const u8* gl = &nftr_data[sFontSpecs.cglp_offset + 0x10 + offset];
+		// Rows are opaque masks (pixel x is bit x), followed by two color planes for 2 bpp fonts
+		const FontGlyph* glyph = (const FontGlyph*)(font_data + sFontSpecs.glyphs_offset + index * sFontSpecs.glyph_size);
+		const u16* row = glyph->rows;
+		_TRACE_GLYPH(sFontSpecs.glyph_size);
 		
-		u16 pixel_pos = 0;
-		if (align == ALIGN_LEFT) { // Draw to VRAM directly
-			if (sFontSpecs.bpp == 1) {
-				for (u8 a = 0; a < sFontSpecs.bytes_per_char; a++) {
-					for (u8 b = 0; b < 8; b++) {
-						pixels[pixel_pos++] = ((gl[a] >> (7 - b)) & 1);
-					}
-				}
-				for (u8 x = 0; x < sFontSpecs.max_height; x++) {
-					for (u8 y = 0; y < sFontSpecs.max_width; y++) {
-						u8 p = pixels[(x * sFontSpecs.max_width) + y];
-						if (p == 1) {
-							SetPixel(vram, py + x, px + y + pos_left, 254 - color_modifier);
-						}
-					}
-				}
-			} else if (sFontSpecs.bpp == 2) {
-				for (u8 a = 0; a < sFontSpecs.bytes_per_char; a++) {
-					for (u8 b = 0; b < 8; b += sFontSpecs.bpp) {
-						u8 p = 0;
-						for (u8 bit = 0; bit < sFontSpecs.bpp; bit++) {
-							p |= ((gl[a] >> (7 - (b + bit))) & 1) << bit;
-						}
-						pixels[pixel_pos++] = p;
-					}
-				}
-				for (u8 x = 0; x < sFontSpecs.max_height; x++) {
-					for (u8 y = 0; y < sFontSpecs.max_width; y++) {
-						u8 p = pixels[(x * sFontSpecs.max_width) + y];
-						if (p != 0) {
-							SetPixel(vram, py + x, px + y + pos_left, p + 250 - color_modifier);
-						}
-					}
-				}
+		for (u8 y = 0; y < sFontSpecs.max_height; y++, row += sFontSpecs.row_size >> 1) {
+			u32 mask = row[0];
+			if (mask == 0) continue;
+			u32 plane0 = 0;
+			u32 plane1 = 0;
+			if (sFontSpecs.bpp == 2) {
+				plane0 = row[1];
+				plane1 = row[2];
 			}
-		} else {
-			if (sFontSpecs.bpp == 1) {
-				for (u8 a = 0; a < sFontSpecs.bytes_per_char; a++) {
-					for (u8 b = 0; b < 8; b++) {
-						pixels[pixel_pos++] = ((gl[a] >> (7 - b)) & 1);
-					}
-				}
-				for (u8 x = 0; x < sFontSpecs.max_height; x++) {
-					for (u8 y = 0; y < sFontSpecs.max_width; y++) {
-						u8 p = pixels[(x * sFontSpecs.max_width) + y];
-						if (p == 1) {
-							canvas[(x * SCREEN_WIDTH) + y + pos_left] = 254 - color_modifier;
-						}
-					}
-				}
-			} else if (sFontSpecs.bpp == 2) {
-				for (u8 a = 0; a < sFontSpecs.bytes_per_char; a++) {
-					for (u8 b = 0; b < 8; b += sFontSpecs.bpp) {
-						u8 p = 0;
-						for (u8 bit = 0; bit < sFontSpecs.bpp; bit++) {
-							p |= ((gl[a] >> (7 - (b + bit))) & 1) << bit;
-						}
-						pixels[pixel_pos++] = p;
-					}
-				}
-				for (u8 x = 0; x < sFontSpecs.max_height; x++) {
-					for (u8 y = 0; y < sFontSpecs.max_width; y++) {
-						u8 p = pixels[(x * sFontSpecs.max_width) + y];
-						if (p != 0) {
-							canvas[(x * SCREEN_WIDTH) + y + pos_left] = p + 250 - color_modifier;
-						}
+			if (align == ALIGN_LEFT) { // Draw to VRAM directly
+				DrawGlyphRow((volatile u16*)vram + (py + y) * (SCREEN_WIDTH >> 1), px + pos_left, mask, plane0, plane1, color);
+			} else {
+				u8* line = &canvas[(y * SCREEN_WIDTH) + pos_left];
+				for (u8 x = 0; mask != 0; x++, mask >>= 1, plane0 >>= 1, plane1 >>= 1) {
+					if (mask & 1) {
+						line[x] = color + (plane0 & 1) + ((plane1 & 1) << 1);
 					}
 				}
 			}
 		}
 		
-		pos_left += glyph_width;
+		pos_left += glyph_advance;
 		if (last_ch) break;
 	}
 	
@@ -0,0 +1,77 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <gba_dma.h>
+#include <gba_interrupt.h>
+#include <string.h>
+
+#include "main.h"
+#include "highlight.h"
+
+// Text colors for every scanline; HBlank DMA copies the entry of the next line into the palette
+u16 highlight_lines[SCREEN_HEIGHT + 1][HIGHLIGHT_PALETTE_COUNT];
+const u16 highlight_colors[2][HIGHLIGHT_PALETTE_COUNT] = {
+	{ 0xB18C, 0xDEF7, 0x9084, 0x8000 }, // normal
+	{ 0xDD8C, 0xFAF7, 0xC084, 0xC084 }, // selected
+};
+s8 highlight_row = -1;
+
+IWRAM_CODE void HighlightVCount(void)
+{
+	// Runs at the start of VBlank; also while flash routines have the VBlank interrupt masked, so no ROM access here
+	REG_DMA0CNT = 0;
+	for (u8 i = 0; i < HIGHLIGHT_PALETTE_COUNT; i++)
+	{
+		((vu16 *)AGB_PRAM)[HIGHLIGHT_PALETTE_FIRST + i] = highlight_lines[0][i];
+	}
+	REG_DMA0SAD = (u32)highlight_lines[1];
+	REG_DMA0DAD = (u32)AGB_PRAM + HIGHLIGHT_PALETTE_FIRST * 2;
+	REG_DMA0CNT = DMA_ENABLE | DMA_HBLANK | DMA_REPEAT | DMA16 | DMA_DST_RELOAD | HIGHLIGHT_PALETTE_COUNT;
+}
+
+void HighlightInit(void)
+{
+	for (u8 y = 0; y <= SCREEN_HEIGHT; y++)
+	{
+		memcpy(highlight_lines[y], highlight_colors[0], sizeof(highlight_lines[y]));
+	}
+	highlight_row = -1;
+
+	REG_DISPSTAT = (REG_DISPSTAT & 0x00FF) | (SCREEN_HEIGHT << 8);
+	irqSet(IRQ_VCOUNT, HighlightVCount);
+	irqEnable(IRQ_VCOUNT);
+}
+
+void HighlightSetRow(s8 row)
+{
+	// List rows are 14 lines high, starting at line 27
+	if (row == highlight_row) return;
+	if (highlight_row >= 0)
+	{
+		for (u8 y = 27 + highlight_row * 14; y < 41 + highlight_row * 14; y++)
+		{
+			memcpy(highlight_lines[y], highlight_colors[0], sizeof(highlight_lines[y]));
+		}
+	}
+	if (row >= 0)
+	{
+		for (u8 y = 27 + row * 14; y < 41 + row * 14; y++)
+		{
+			memcpy(highlight_lines[y], highlight_colors[1], sizeof(highlight_lines[y]));
+		}
+	}
+	highlight_row = row;
+}
+
+void HighlightStop(void)
+{
+	irqDisable(IRQ_VCOUNT);
+	REG_DMA0CNT = 0;
+	for (u8 i = 0; i < HIGHLIGHT_PALETTE_COUNT; i++)
+	{
+		((vu16 *)AGB_PRAM)[HIGHLIGHT_PALETTE_FIRST + i] = highlight_colors[0][i];
+	}
+}
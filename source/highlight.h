@@ -0,0 +1,19 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#ifndef HIGHLIGHT_H_
+#define HIGHLIGHT_H_
+
+#include "main.h"
+
+#define HIGHLIGHT_PALETTE_FIRST 251 // text colors swapped per scanline
+#define HIGHLIGHT_PALETTE_COUNT 4
+
+IWRAM_CODE void HighlightVCount(void);
+void HighlightInit(void);
+void HighlightSetRow(s8 row);
+void HighlightStop(void);
+
+#endif
@@ -0,0 +1,80 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <string.h>
+
+#include "main.h"
+#include "itemlist.h"
+
+extern u8 *itemlist;
+extern u32 flash_sector_size;
+
+ItemListHeader sItemListHeader;
+const ItemGroup *item_groups = NULL;
+const ItemRecord *item_records = NULL;
+const u16 *item_strings = NULL;
+
+BOOL ItemListInit(void)
+{
+	// The header is read once; groups, records and titles are accessed in place
+	memcpy(&sItemListHeader, itemlist, sizeof(sItemListHeader));
+	_TRACE_ROM_READ(sizeof(sItemListHeader));
+	if ((sItemListHeader.magic != MAGIC_ITEM_LIST) || (sItemListHeader.version != ITEM_LIST_VERSION))
+		return FALSE;
+	if ((sItemListHeader.size > SORT_TABLES_OFFSET) || (sItemListHeader.strings_offset > sItemListHeader.size))
+		return FALSE;
+
+	u32 checksum = 0;
+	_TRACE_ROM_READ(sItemListHeader.size - sizeof(sItemListHeader));
+	for (u32 i = sizeof(sItemListHeader); i < sItemListHeader.size; i += 4)
+	{
+		checksum += *(vu32 *)(itemlist + i);
+	}
+	if (checksum != sItemListHeader.checksum)
+		return FALSE;
+
+	item_groups = (const ItemGroup *)(itemlist + sizeof(sItemListHeader));
+	item_records = (const ItemRecord *)(item_groups + sItemListHeader.group_count);
+	item_strings = (const u16 *)(itemlist + sItemListHeader.strings_offset);
+	return TRUE;
+}
+
+const ItemGroup *ItemListFindGroup(u16 keys)
+{
+	if (item_groups == NULL)
+		return NULL;
+	for (u16 i = 0; i < sItemListHeader.group_count; i++)
+	{
+		_TRACE_ROM_READ(sizeof(ItemGroup));
+		if (item_groups[i].keys == keys)
+			return &item_groups[i];
+	}
+	return NULL;
+}
+
+void ItemListGet(u16 index, ItemConfig *config)
+{
+	const ItemRecord *record = &item_records[index];
+	_TRACE_ROM_READ(sizeof(ItemRecord) + record->title_length * 2);
+	config->font = record->font;
+	config->title_length = record->title_length;
+	if (config->title_length > 0x30)
+		config->title_length = 0x30;
+	config->rom_offset = record->rom_offset;
+	config->rom_size = record->rom_size;
+	config->save_type = record->save_type;
+	config->save_index = record->save_index;
+	config->preview = record->preview;
+	memset(config->title, 0, sizeof(config->title));
+	memcpy(config->title, item_strings + record->title_offset, config->title_length * 2);
+}
+
+const u8 *ItemListGetPreviews(void)
+{
+	if ((item_records == NULL) || (sItemListHeader.preview_sector == 0))
+		return NULL;
+	return itemlist + sItemListHeader.preview_sector * flash_sector_size;
+}
@@ -0,0 +1,53 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#ifndef ITEMLIST_H_
+#define ITEMLIST_H_
+
+#include "main.h"
+
+#define MAGIC_ITEM_LIST 0x4C494B4C
+#define ITEM_LIST_VERSION 2
+#define PREVIEW_NONE 0xFFFF
+
+typedef struct ItemListHeader_
+{
+    u32 magic;
+    u16 version;
+    u16 count;          // number of records
+    u16 group_count;
+    u16 strings_offset; // byte offset of the title pool within the item list sector
+    u16 size;           // header, groups, records and title pool, padded to 4 bytes
+    u16 preview_sector; // preview images, in sectors after the item list sector; 0 if there are none
+    u32 checksum;       // 32-bit sum of the words following the header
+} ItemListHeader;
+
+// Records are grouped by the keys that have to be held on boot to show them
+typedef struct ItemGroup_
+{
+    u16 keys;
+    u16 first;
+    u16 count;
+    u16 reserved;
+} ItemGroup;
+
+typedef struct ItemRecord_
+{
+    u8 font;
+    u8 title_length; // UTF-16 code units
+    u16 rom_offset;
+    u16 rom_size;
+    u8 save_type;
+    u8 save_index;
+    u16 title_offset; // UTF-16 code units into the title pool
+    u16 preview;      // index into the preview images, PREVIEW_NONE if there is none
+} ItemRecord;
+
+BOOL ItemListInit(void);
+const ItemGroup *ItemListFindGroup(u16 keys);
+void ItemListGet(u16 index, ItemConfig *config);
+const u8 *ItemListGetPreviews(void);
+
+#endif
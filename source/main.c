@@ -18,28 +18,38 @@ Author: Lesserkuma (github.com/lesserkuma)
 #include "main.h"
 #include "font.h"
 #include "flash.h"
+#include "verify.h"
+#include "profile.h"
+#include "highlight.h"
+#include "sprites.h"
+#include "marquee.h"
+#include "preview.h"
+#include "itemlist.h"
 
 extern FontSpecs sFontSpecs;
 extern u16 FallbackCharacter;
-extern u16 ArrowCharacter;
 extern s8 FontMarginTop;
 extern s8 FontMarginBottom;
 extern const u8* font;
 extern u8 *itemlist;
 extern u8 flash_type;
-extern u16 itemlist_offset;
+extern u16 itemlist_start;
 extern u32 flash_sector_size;
 extern u32 flash_itemlist_sector_offset;
 extern u32 flash_status_sector_offset;
 extern u32 flash_save_sector_offset;
-extern u8 data_buffer[0x10000];
+extern FlashWear flash_wear;
 ItemConfig sItemConfig;
 FlashStatus sFlashStatus;
+SortTablesHeader sSortTablesHeader;
+const u16 *sort_tables = NULL;
+u8 sort_order = 0;
 
-void SetPixel(volatile u16* buffer, u8 row, u8 col, u8 color) {
+RENDER_CODE void SetPixel(volatile u16* buffer, u8 row, u8 col, u8 color) {
 	/* https://ianfinlayson.net/class/cpsc305/notes/09-graphics */
 	u16 offset = (row * SCREEN_WIDTH + col) >> 1;
 	u16 pixel = buffer[offset];
+	_TRACE_VRAM_WRITE(&buffer[offset], 2);
 	if (col & 1) {
 		buffer[offset] = (color << 8) | (pixel & 0x00FF);
 	} else {
@@ -47,15 +57,22 @@ void SetPixel(volatile u16* buffer, u8 row, u8 col, u8 color) {
 	}
 }
 
-void ClearList(void* vram, u8 top, u8 height) {
+RENDER_CODE void ClearList(void* vram, u8 top, u8 height) {
 	dmaCopy(bgBitmap + (top * (SCREEN_WIDTH >> 2)), (void*)AGB_VRAM+0xA000 + (top * SCREEN_WIDTH), SCREEN_WIDTH * height);
 }
 
+u16 GetItemIndex(u16 position) {
+	// Position in the list for the active sort order -> item index within the current list
+	if (sort_order == 0) return position;
+	_TRACE_ROM_READ(2);
+	return sort_tables[(sort_order - 1) * sSortTablesHeader.count + itemlist_start + position] - itemlist_start;
+}
+
 int main(void) {
 	char temp_ascii[64];
 	u16 temp_unicode[64];
-	s8 page_active = 0;
-	u8 page_total = 64;
+	s16 page_active = 0;
+	u16 page_total = 64;
 	u16 roms_total = 0;
 	s8 cursor_pos = 0;
 	u8 redraw_items = 0xFF;
@@ -63,16 +80,26 @@ int main(void) {
 	u16 kHeld = 0;
 	u16 kHeld_boot = 0;
 	BOOL show_debug = FALSE;
+	BOOL show_wear = FALSE;
 	BOOL show_credits = FALSE;
+	BOOL run_verify = FALSE;
+#ifdef RENDER_PROFILE
+	BOOL run_profile = FALSE;
+#endif
 	BOOL boot_failed = FALSE;
 
+	// Before anything touches the mapper
+	SaveRegisterBackup();
+
 	irqInit();
 	irqEnable(IRQ_VBLANK);
 
-	FlashDetectType();
+	// Keep the display off until the first page is ready, so nothing has to be cleared up front
+	REG_DISPCNT = LCDC_OFF;
+	FlashInit(&sFlashStatus);
+	FlashTuneWaitstates(&sFlashStatus);
 
 	// Load palette
-	memset((void*)AGB_VRAM, 255, SCREEN_WIDTH * SCREEN_HEIGHT * 2);
 	dmaCopy(bgPal, BG_PALETTE, 256 * 2);
 	((u16*)AGB_PRAM)[250] = 0xFFFF;
 	((u16*)AGB_PRAM)[251] = 0xB18C;
@@ -86,10 +113,9 @@ int main(void) {
 	((u16*)AGB_PRAM)[243] = 0xC084;
 	((u16*)AGB_PRAM)[244] = 0xC084;
 	((u16*)AGB_PRAM)[245] = 0xFFFF;
-	VBlankIntrWait();
 
 	// Load background
-	SetMode(MODE_4 | BG2_ENABLE);
+	SetMode(MODE_4 | BG2_ENABLE | LCDC_OFF);
 	dmaCopy(bgBitmap, (void*)AGB_VRAM+0xA000, SCREEN_WIDTH * SCREEN_HEIGHT);
 	
 	// Check on-boot keys
@@ -98,33 +124,51 @@ int main(void) {
 	kHeld_boot = kHeld;
 	if ((kHeld & KEY_SELECT) && (kHeld & KEY_R)) {
 		show_credits = TRUE;
+	} else if ((kHeld & KEY_SELECT) && (kHeld & KEY_L)) {
+		run_verify = TRUE;
+#ifdef RENDER_PROFILE
+	} else if ((kHeld & KEY_SELECT) && (kHeld & KEY_START)) {
+		run_profile = TRUE;
+#endif
 	} else if (kHeld & KEY_SELECT) {
 		show_debug = TRUE;
 	}
-	if (kHeld) {
-		BOOL found_keys = FALSE;
-		for (itemlist_offset = 0; itemlist_offset < 0xE000; itemlist_offset += 0x70) {
-			memcpy(&sItemConfig, ((u8*)itemlist)+itemlist_offset, sizeof(sItemConfig));
-			if (sItemConfig.title_length == 0) break;
-			if (sItemConfig.title_length == 0xFF) break;
-			if (sItemConfig.keys == kHeld) {
-				found_keys = TRUE;
-				break;
-			}
-		}
-		if (!found_keys) {
+
+	// Find the group of ROMs for the keys held on boot
+	itemlist_start = 0;
+	if (ItemListInit()) {
+		const ItemGroup *group = ItemListFindGroup(kHeld);
+		if (group == NULL) {
 			kHeld = 0;
-			itemlist_offset = 0;
+			group = ItemListFindGroup(0);
+		}
+		if (group != NULL) {
+			itemlist_start = group->first;
+			roms_total = group->count;
 		}
 	}
 
-	// Count number of ROMs
-	for (roms_total = 0; roms_total < 512; roms_total++) {
-		memcpy(&sItemConfig, ((u8*)itemlist+itemlist_offset)+(0x70*roms_total), sizeof(sItemConfig));
-		if (sItemConfig.keys != kHeld) break;
-		if (sItemConfig.title_length == 0) break;
-		if (sItemConfig.title_length == 0xFF) break;
+	// Status record was already read by FlashInit()
+	if (sFlashStatus.magic != MAGIC_FLASH_STATUS) {
+		sFlashStatus.magic = MAGIC_FLASH_STATUS;
+		sFlashStatus.version = 0;
+		sFlashStatus.battery_present = 1;
+		sFlashStatus.last_boot_menu_index = 0xFFFF;
+		sFlashStatus.last_boot_save_index = 0xFF;
+		sFlashStatus.last_boot_save_type = SRAM_NONE;
+		sFlashStatus.last_boot_list_start = 0;
+	} else if ((sFlashStatus.last_boot_menu_index < roms_total) && (sFlashStatus.last_boot_list_start == itemlist_start)) {
+		cursor_pos = sFlashStatus.last_boot_menu_index % 8;
+		page_active = sFlashStatus.last_boot_menu_index / 8;
+
+		// Holding START on boot launches the last played game right away
+		if ((kHeld_boot == KEY_START) && (kHeld == 0)) {
+			ItemListGet(itemlist_start + sFlashStatus.last_boot_menu_index, &sItemConfig);
+			u8 error_code = BootGame(sItemConfig, sFlashStatus);
+			boot_failed = error_code;
+		}
 	}
+
 	if (roms_total == 0) {
 		LoadFont(2);
 		DrawText(0, 64, ALIGN_CENTER, u"Please use the ROM Builder to", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
@@ -132,32 +176,53 @@ int main(void) {
 		LoadFont(0);
 		DrawText(0, 127, ALIGN_CENTER, u"https://github.com/lesserkuma/GBA_MultiMenu", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
 		DrawText(14, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_RIGHT, u"No ROMs", 10, font, (void*)AGB_VRAM+0xA000, FALSE);
-		REG_DISPCNT ^= 0x0010;
+		REG_DISPCNT = (REG_DISPCNT ^ 0x0010) & ~LCDC_OFF;
 		while (1) { VBlankIntrWait(); }
-	} else if (roms_total == 1) {
-		memcpy(&sItemConfig, ((u8*)itemlist+itemlist_offset), sizeof(sItemConfig));
+	} else if ((roms_total == 1) && !boot_failed) {
+		ItemListGet(itemlist_start, &sItemConfig);
 		u8 error_code = BootGame(sItemConfig, sFlashStatus);
 		boot_failed = error_code;
 	}
 	page_total = (roms_total + 8.0 - 1) / 8.0;
 
-	memcpy(&sFlashStatus, (void *)(AGB_ROM + flash_status_sector_offset * flash_sector_size), sizeof(sFlashStatus));
-	if ((sFlashStatus.magic != MAGIC_FLASH_STATUS) || (sFlashStatus.last_boot_menu_index >= roms_total)) {
-		sFlashStatus.magic = MAGIC_FLASH_STATUS;
-		sFlashStatus.version = 0;
-		sFlashStatus.battery_present = 1;
-		sFlashStatus.last_boot_menu_index = 0xFFFF;
-		sFlashStatus.last_boot_save_index = 0xFF;
-		sFlashStatus.last_boot_save_type = SRAM_NONE;
+	// Alternative sort orders precomputed by the ROM Builder
+	memcpy(&sSortTablesHeader, ((u8*)itemlist)+SORT_TABLES_OFFSET, sizeof(sSortTablesHeader));
+	_TRACE_ROM_READ(sizeof(sSortTablesHeader));
+	if ((sSortTablesHeader.magic == MAGIC_SORT_TABLES) && (sSortTablesHeader.version == 1)) {
+		sort_tables = (const u16*)(((u8*)itemlist)+SORT_TABLES_OFFSET+sizeof(sSortTablesHeader));
 	} else {
-		cursor_pos = sFlashStatus.last_boot_menu_index % 8;
-		page_active = sFlashStatus.last_boot_menu_index / 8;
+		sSortTablesHeader.order_count = 0;
+	}
+
+	if (run_verify) {
+		VerifyCartridge();
 	}
+#ifdef RENDER_PROFILE
+	if (run_profile) {
+		RenderProfile();
+	}
+#endif
+
+	// Compare the previous game's save data with its flash slot while the menu is idle (holding SELECT on boot skips the write-back)
+	if (!(kHeld_boot & KEY_SELECT)) {
+		SaveWriteBackStart(&sFlashStatus);
+	}
+
+	// Cursor arrow and counter are sprites; the selected row is highlighted by rewriting the text palette per scanline
+	SpritesInit();
+	HighlightInit();
+	PreviewInit();
 
 	s32 wait = 0;
 	u8 f = 0;
+	u16 idle_frames = 0;
+	BOOL in_vblank = FALSE;
 	while (1) {
 		if (redraw_items != 0) {
+			MarqueeStop();
+			PreviewStop();
+			// Cursor moves only touch the highlight table and sprites, the bitmap is redrawn for new pages and status texts
+			BOOL redraw_bitmap = (redraw_items == 0xFF) || show_debug;
 			if (redraw_items == 0xFF) {
 				// Full redraw (new page etc.)
 				roms_page = 7;
@@ -170,67 +235,73 @@ int main(void) {
 				if (roms_page < 7) ClearList((void*)AGB_VRAM+0xA000, 26+(roms_page+1)*14, 14*(8-roms_page));
 				if (cursor_pos > roms_page) cursor_pos = roms_page;
 				for (u8 i = 0; i <= roms_page; i++) {
-					memcpy(&sItemConfig, ((u8*)itemlist+itemlist_offset)+0x70*(page_active*8+i), sizeof(sItemConfig));
+					ItemListGet(itemlist_start + GetItemIndex(page_active*8+i), &sItemConfig);
 					ClearList((void*)AGB_VRAM+0xA000, 27+i*14, 14);
 					LoadFont(sItemConfig.font);
-					DrawText(28, 26+i*14, ALIGN_LEFT, sItemConfig.title, sItemConfig.title_length, font, (void*)AGB_VRAM+0xA000, i == cursor_pos);
-				}
-			} else {
-				// Re-draw only changed list items (cursor moved up or down)
-				for (u8 i = 0; i < 8; i++) {
-					if ((redraw_items >> i) & 1) {
-						memcpy(&sItemConfig, ((u8*)itemlist+itemlist_offset)+0x70*(page_active*8+i), sizeof(sItemConfig));
-						ClearList((void*)AGB_VRAM+0xA000, 27+i*14, 14);
-						LoadFont(sItemConfig.font);
-						DrawText(28, 26+i*14, ALIGN_LEFT, sItemConfig.title, sItemConfig.title_length, font, (void*)AGB_VRAM+0xA000, i == cursor_pos);
-					}
+					DrawText(28, 26+i*14, ALIGN_LEFT, sItemConfig.title, sItemConfig.title_length, font, (void*)AGB_VRAM+0xA000, FALSE);
 				}
 			}
+			HighlightSetRow(cursor_pos);
+			SpritesSetCursor(cursor_pos);
+			SpritesSetCounter(page_active*8+cursor_pos+1, roms_total);
 			
-			memcpy(&sItemConfig, ((u8*)itemlist+itemlist_offset)+0x70*(page_active*8+cursor_pos), sizeof(sItemConfig));
+			ItemListGet(itemlist_start + GetItemIndex(page_active*8+cursor_pos), &sItemConfig);
+			MarqueeSet(cursor_pos, &sItemConfig);
+			PreviewSet(cursor_pos, &sItemConfig);
 
-			// Draw cursor
-			LoadFont(1);
-			ClearList((void*)AGB_VRAM+0xA000, SCREEN_HEIGHT - sFontSpecs.max_height - 1, sFontSpecs.max_height);
-			u16 arrow[1] = { ArrowCharacter };
-			DrawText(14, 26+cursor_pos*14, ALIGN_LEFT, (u16*)&arrow, 1, font, (void*)AGB_VRAM+0xA000, FALSE);
-			
-			// Draw status bar
-			LoadFont(2);
-			memset(temp_unicode, 0, sizeof(temp_unicode));
-			snprintf(temp_ascii, 10+1, "%d/%d", page_active*8+cursor_pos+1, roms_total);
-			AsciiToUnicode(temp_ascii, temp_unicode);
-			DrawText(11, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_RIGHT, temp_unicode, 10, font, (void*)AGB_VRAM+0xA000, FALSE);
-			if (boot_failed) {
-				LoadFont(0);
-				if (boot_failed == 1) {
-					DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Error: Unsupported cartridge!", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
-				} else if (boot_failed == 2) {
-					DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Error: Mapper is not responding!", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
-				} else {
-					DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Error: Game couldn't be launched!", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
+			if (redraw_bitmap) {
+				// Draw status bar
+				LoadFont(1);
+				ClearList((void*)AGB_VRAM+0xA000, SCREEN_HEIGHT - sFontSpecs.max_height - 1, sFontSpecs.max_height);
+				if (boot_failed) {
+					LoadFont(0);
+					if (boot_failed == 1) {
+						DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Error: Unsupported cartridge!", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
+					} else if (boot_failed == 2) {
+						DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Error: Mapper is not responding!", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
+					} else {
+						DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Error: Game couldn't be launched!", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
+					}
+				} else if (show_credits) {
+					LoadFont(0);
+					memset(temp_unicode, 0, sizeof(temp_unicode));
+					snprintf(temp_ascii, 48, "Menu by LK - %s", BUILDTIME);
+					AsciiToUnicode(temp_ascii, temp_unicode);
+					DrawText(6, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, temp_unicode, 48, font, (void*)AGB_VRAM+0xA000, FALSE);
+				} else if (show_debug && show_wear) {
+					// Erase counts of the status sector and the selected game's save sector, average operation times on this chip
+					LoadFont(0);
+					u32 erase_ms = flash_wear.erase_count ? (u32)(flash_wear.erase_ticks * 1000 / FLASH_TIMER_HZ / flash_wear.erase_count) : 0;
+					u32 program_us = flash_wear.program_count ? (u32)(flash_wear.program_ticks * 1000000 / FLASH_TIMER_HZ / flash_wear.program_count) : 0;
+					snprintf(temp_ascii, 64, "T%d|ST:%d|SV:%d|ER:%dms|PG:%dus", flash_wear.flash_type, (int)flash_wear.status_erases, (int)flash_wear.save_erases[sItemConfig.save_index], (int)erase_ms, (int)program_us);
+					memset(temp_unicode, 0, sizeof(temp_unicode));
+					AsciiToUnicode(temp_ascii, temp_unicode);
+					DrawText(6, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, temp_unicode, 64, font, (void*)AGB_VRAM+0xA000, FALSE);
+				} else if (show_debug) {
+					LoadFont(0);
+					u8 a = ((sItemConfig.rom_offset / 0x40) & 0xF) << 4;
+					u8 b = 0x40 + (sItemConfig.rom_offset % 0x40);
+					u8 c = 0x40 - sItemConfig.rom_size;
+					snprintf(temp_ascii, 64, "%02X:%02X:%02X|0x%X~%dMiB|%X", a, b, c, (int)(sItemConfig.rom_offset * 512 * 1024), (int)(sItemConfig.rom_size * 512 >> 10), (int)(flash_save_sector_offset + sItemConfig.save_index));
+					memset(temp_unicode, 0, sizeof(temp_unicode));
+					AsciiToUnicode(temp_ascii, temp_unicode);
+					DrawText(6, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, temp_unicode, 64, font, (void*)AGB_VRAM+0xA000, FALSE);
+				} else if (sort_order == 1) {
+					LoadFont(0);
+					DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Sorted by title", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
+				} else if (sort_order == 2) {
+					LoadFont(0);
+					DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Sorted by size", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
+				} else if (sort_order == 3) {
+					LoadFont(0);
+					DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Sorted by save slot", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
 				}
-			} else if (show_credits) {
-				LoadFont(0);
-				memset(temp_unicode, 0, sizeof(temp_unicode));
-				snprintf(temp_ascii, 48, "Menu by LK - %s", BUILDTIME);
-				AsciiToUnicode(temp_ascii, temp_unicode);
-				DrawText(6, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, temp_unicode, 48, font, (void*)AGB_VRAM+0xA000, FALSE);
-			} else if (show_debug) {
-				LoadFont(0);
-				u8 a = ((sItemConfig.rom_offset / 0x40) & 0xF) << 4;
-				u8 b = 0x40 + (sItemConfig.rom_offset % 0x40);
-				u8 c = 0x40 - sItemConfig.rom_size;
-				snprintf(temp_ascii, 64, "%02X:%02X:%02X|0x%X~%dMiB|%X", a, b, c, (int)(sItemConfig.rom_offset * 512 * 1024), (int)(sItemConfig.rom_size * 512 >> 10), (int)(flash_save_sector_offset + sItemConfig.save_index));
-				memset(temp_unicode, 0, sizeof(temp_unicode));
-				AsciiToUnicode(temp_ascii, temp_unicode);
-				DrawText(6, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, temp_unicode, 64, font, (void*)AGB_VRAM+0xA000, FALSE);
-			}
 			
-			// VRAM bank swapping
-			REG_DISPCNT ^= 0x0010;
-			dmaCopy((void*)AGB_VRAM+0xA000, (void*)AGB_VRAM, SCREEN_WIDTH * SCREEN_HEIGHT);
-			REG_DISPCNT ^= 0x0010;
+				// VRAM bank swapping
+				REG_DISPCNT ^= 0x0010;
+				dmaCopy((void*)AGB_VRAM+0xA000, (void*)AGB_VRAM, SCREEN_WIDTH * SCREEN_HEIGHT);
+				REG_DISPCNT = (REG_DISPCNT ^ 0x0010) & ~LCDC_OFF;
+			}
 			redraw_items = 0;
 		}
 		
@@ -244,9 +315,26 @@ int main(void) {
 		}
 		if (kHeld != 0) {
 			wait++;
+			idle_frames = 0;
 		} else {
 			f = 0;
 		}
+
+		// Title scrolling, the preview image, and the background save comparison once no keys have been pressed for a while; one step per frame
+		if (REG_VCOUNT >= SCREEN_HEIGHT) {
+			if (!in_vblank && (kHeld == 0)) {
+				MarqueeStep();
+				PreviewStep();
+				if (idle_frames < SAVE_WRITEBACK_IDLE_FRAMES) {
+					idle_frames++;
+				} else {
+					SaveWriteBackStep();
+				}
+			}
+			in_vblank = TRUE;
+		} else {
+			in_vblank = FALSE;
+		}
 		if (((kHeld & 0x3FF) && !f) || (wait > 1000)) {
 			if (!f) {
 				wait = -8000;
@@ -256,11 +344,14 @@ int main(void) {
 			f = 1;
 			
 			if (boot_failed) {
+				HighlightStop();
+				REG_TM0CNT = 0; // flash timers, a soft reset keeps them running
+				REG_TM1CNT = 0;
 				SystemCall(0); // Soft reset
 			}
 
 			if ((kHeld & KEY_A) || (kHeld & KEY_START)) {
-				sFlashStatus.last_boot_menu_index = page_active * 8 + cursor_pos;
+				sFlashStatus.last_boot_menu_index = GetItemIndex(page_active * 8 + cursor_pos);
 				if (!show_credits && !show_debug) {
 					LoadFont(0);
 					DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, u"Loading… Don't turn off the power!", 48, font, (void*)AGB_VRAM+0xA000, FALSE);
@@ -271,13 +362,17 @@ int main(void) {
 				if (kHeld & KEY_SELECT) {
 					// Skips reading latest save data from SRAM
 					sFlashStatus.last_boot_save_type = SRAM_NONE;
+					SaveWriteBackCancel();
 				}
 				u8 error_code = BootGame(sItemConfig, sFlashStatus);
 				boot_failed = error_code;
 				redraw_items = 0xFF;
-				REG_IE = 1;
+				REG_IE = IRQ_VBLANK | IRQ_VCOUNT;
 
 			} else if (kHeld & KEY_B) {
+				HighlightStop();
+				REG_TM0CNT = 0; // flash timers, a soft reset keeps them running
+				REG_TM1CNT = 0;
 				SystemCall(0); // Soft reset
 
 			} else if ((kHeld & KEY_LEFT) || (kHeld & KEY_RIGHT)) {
@@ -309,6 +404,28 @@ int main(void) {
 				if (page_active > page_total - 1) page_active = 0;
 				if (page_active < 0) page_active = page_total - 1;
 				redraw_items |= 1 << cursor_pos;
+
+			} else if (((kHeld & KEY_L) || (kHeld & KEY_R)) && (sSortTablesHeader.order_count > 0)) {
+				// Switch sort order and keep the selected game under the cursor
+				u16 selected = GetItemIndex(page_active * 8 + cursor_pos);
+				if (kHeld & KEY_R) {
+					sort_order = (sort_order + 1) % (sSortTablesHeader.order_count + 1);
+				} else {
+					sort_order = (sort_order + sSortTablesHeader.order_count) % (sSortTablesHeader.order_count + 1);
+				}
+				for (u16 i = 0; i < roms_total; i++) {
+					if (GetItemIndex(i) == selected) {
+						page_active = i / 8;
+						cursor_pos = i % 8;
+						break;
+					}
+				}
+				redraw_items = 0xFF;
+
+			} else if ((kHeld & KEY_SELECT) && show_debug) {
+				// Switch the debug line between the mapper values and the flash wear record
+				show_wear = !show_wear;
+				redraw_items = 0xFF;
 			}
 		}
 	}
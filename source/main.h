@@ -30,11 +30,31 @@ typedef uint8_t BOOL;
 #define MAPPER_CONFIG4 (volatile void *)0xE000005
 
 #define SRAM_SIZE 64 * 1024
+#define SRAM_SIZE_256K 32 * 1024
+#define SRAM_SIZE_512K 64 * 1024
 
 #define SCREEN_WIDTH 240
 #define SCREEN_HEIGHT 160
 #define SCREEN_MARGIN_RIGHT 7
 
+// Text rendering hot paths, compiled as ARM code into IWRAM with RENDER_IWRAM=1 (see Makefile)
+#ifdef RENDER_IWRAM
+#define RENDER_CODE __attribute__((section(".iwram"), long_call, target("arm")))
+#else
+#define RENDER_CODE
+#endif
+
+// Work counters for host-side builds (see tools/menu_sim); they compile to nothing on the GBA
+#ifndef _TRACE_VRAM_WRITE
+#define _TRACE_VRAM_WRITE(address, bytes)
+#endif
+#ifndef _TRACE_ROM_READ
+#define _TRACE_ROM_READ(bytes)
+#endif
+#ifndef _TRACE_GLYPH
+#define _TRACE_GLYPH(bytes)
+#endif
+
 #define V5bit(x) ((x) >> 3)
 #define RGB555(r, g, b) ((V5bit(r) << 0) | (V5bit(g) << 5) | (V5bit(b) << 10) | (((1) & 1) << 15))
 #define RGB555_CLEAR 0
@@ -58,6 +78,7 @@ typedef enum u8
 	SRAM_1M
 } SAVE_TYPE;
 
+// Unpacked item list entry (see itemlist.h for how it is stored)
 typedef struct ItemConfig_
 {
 	u8 font;
@@ -66,13 +87,25 @@ typedef struct ItemConfig_
 	u16 rom_size;
 	SAVE_TYPE save_type;
 	u8 save_index;
-	u16 keys;
-	u8 reserved[6];
+	u16 preview;
 	u16 title[0x30];
 } ItemConfig;
 
+#define MAGIC_SORT_TABLES 0x4F534B4C
+#define SORT_TABLES_OFFSET 0xE000 // within the item list sector
+
+typedef struct SortTablesHeader_
+{
+	u32 magic;
+	u16 version;
+	u16 count;
+	u16 order_count;
+	u16 reserved[3];
+} SortTablesHeader;
+
 extern char __rom_end__;
 
-void SetPixel(volatile u16 *buffer, u8 row, u8 col, u8 color);
+RENDER_CODE void SetPixel(volatile u16 *buffer, u8 row, u8 col, u8 color);
+RENDER_CODE void ClearList(void *vram, u8 top, u8 height);
 
 #endif
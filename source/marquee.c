@@ -0,0 +1,175 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <gba_dma.h>
+#include <string.h>
+
+#include "main.h"
+#include "font.h"
+#include "marquee.h"
+
+extern FontSpecs sFontSpecs;
+extern const u8 *font;
+
+typedef enum
+{
+	MARQUEE_OFF,
+	MARQUEE_WAIT,
+	MARQUEE_SCROLL,
+	MARQUEE_END
+} MARQUEE_STATE;
+
+// The selected title is rasterized once into this strip; scrolling only copies from it
+EWRAM_BSS u8 marquee_strip[MARQUEE_HEIGHT][MARQUEE_STRIP_WIDTH];
+EWRAM_BSS u16 marquee_scratch[SCREEN_WIDTH * 32 / 2];
+u16 marquee_title[0x30];
+u8 marquee_title_length;
+u8 marquee_font;
+s8 marquee_row = -1;
+u16 marquee_width;
+u16 marquee_position;
+u8 marquee_timer;
+MARQUEE_STATE marquee_state = MARQUEE_OFF;
+BOOL marquee_drawn = FALSE;
+
+static u8 MarqueeTop(void)
+{
+	return 27 + marquee_row * 14;
+}
+
+static void MarqueeRestore(void)
+{
+	// The back page still holds the row as DrawText() cut it
+	if (!marquee_drawn) return;
+	u32 offset = MarqueeTop() * SCREEN_WIDTH;
+	dmaCopy((void *)AGB_VRAM + 0xA000 + offset, (void *)AGB_VRAM + offset, SCREEN_WIDTH * MARQUEE_HEIGHT);
+	marquee_drawn = FALSE;
+}
+
+static BOOL MarqueeRender(void)
+{
+	// Returns FALSE if the title isn't cut off, so there is nothing to scroll
+	u16 width = 0;
+	BOOL cut = FALSE;
+	LoadFont(marquee_font);
+	for (u8 i = 0; i < marquee_title_length && marquee_title[i] != 0; i++)
+	{
+		if (width + sFontSpecs.max_width + (sFontSpecs.max_width >> 1) >= SCREEN_WIDTH - SCREEN_MARGIN_RIGHT - MARQUEE_LEFT) cut = TRUE;
+		width += GetGlyphWidth(marquee_title[i], font);
+	}
+	if (!cut) return FALSE;
+	if (width > MARQUEE_STRIP_WIDTH) width = MARQUEE_STRIP_WIDTH;
+	marquee_width = width;
+
+	// DrawText() only draws up to the screen width, so the title is drawn in pieces and pasted together
+	memset(marquee_strip, 0, sizeof(marquee_strip));
+	u16 x = 0;
+	u8 i = 0;
+	while (i < marquee_title_length && marquee_title[i] != 0 && x < width)
+	{
+		u8 first = i;
+		u8 piece_width = 0;
+		while (i < marquee_title_length && marquee_title[i] != 0)
+		{
+			if (piece_width + sFontSpecs.max_width * 2 >= SCREEN_WIDTH - SCREEN_MARGIN_RIGHT) break;
+			piece_width += GetGlyphWidth(marquee_title[i], font);
+			i++;
+		}
+		memset(marquee_scratch, 0, sizeof(marquee_scratch));
+		DrawText(0, 0, ALIGN_LEFT, &marquee_title[first], i - first, font, marquee_scratch, FALSE);
+
+		// Glyphs may reach into the next piece, so only set pixels are copied
+		u8 *pixels = (u8 *)marquee_scratch;
+		for (u8 y = 0; y < MARQUEE_HEIGHT; y++)
+		{
+			u8 *row = pixels + (y + 1) * SCREEN_WIDTH;
+			for (u16 px = 0; px < SCREEN_WIDTH && x + px < MARQUEE_STRIP_WIDTH; px++)
+			{
+				if (row[px] != 0) marquee_strip[y][x + px] = row[px];
+			}
+		}
+		x += piece_width;
+	}
+	return TRUE;
+}
+
+RENDER_CODE static void MarqueeDraw(void)
+{
+	// Title pixels over the background, straight into the displayed page
+	const u8 *background = (const u8 *)bgBitmap;
+	u8 top = MarqueeTop();
+	for (u8 y = 0; y < MARQUEE_HEIGHT; y++)
+	{
+		u32 offset = (top + y) * SCREEN_WIDTH;
+		const u8 *text = &marquee_strip[y][marquee_position];
+		vu16 *vram = (vu16 *)(AGB_VRAM + offset);
+		for (u8 x = MARQUEE_LEFT; x < MARQUEE_RIGHT; x += 2)
+		{
+			u8 a = text[x - MARQUEE_LEFT];
+			u8 b = text[x - MARQUEE_LEFT + 1];
+			if (a == 0) a = background[offset + x];
+			if (b == 0) b = background[offset + x + 1];
+			vram[x >> 1] = a | (b << 8);
+		}
+		_TRACE_VRAM_WRITE(&vram[MARQUEE_LEFT >> 1], MARQUEE_RIGHT - MARQUEE_LEFT);
+	}
+	marquee_drawn = TRUE;
+}
+
+void MarqueeSet(s8 row, ItemConfig *config)
+{
+	// Rendering waits until the cursor has rested on the row for a moment
+	MarqueeStop();
+	memcpy(marquee_title, config->title, sizeof(marquee_title));
+	marquee_title_length = config->title_length;
+	marquee_font = config->font;
+	marquee_row = row;
+	marquee_width = 0;
+	marquee_position = 0;
+	marquee_timer = 0;
+	marquee_state = MARQUEE_WAIT;
+}
+
+void MarqueeStop(void)
+{
+	MarqueeRestore();
+	marquee_state = MARQUEE_OFF;
+}
+
+void MarqueeStep(void)
+{
+	// Called once per frame during VBlank while no keys are held
+	switch (marquee_state)
+	{
+	case MARQUEE_WAIT:
+		if (++marquee_timer < MARQUEE_DELAY_FRAMES) return;
+		if ((marquee_width == 0) && !MarqueeRender())
+		{
+			marquee_state = MARQUEE_OFF;
+			return;
+		}
+		marquee_position = 0;
+		marquee_state = MARQUEE_SCROLL;
+		return;
+	case MARQUEE_SCROLL:
+		marquee_position++;
+		MarqueeDraw();
+		if (marquee_position + (MARQUEE_RIGHT - MARQUEE_LEFT) >= marquee_width)
+		{
+			marquee_timer = 0;
+			marquee_state = MARQUEE_END;
+		}
+		return;
+	case MARQUEE_END:
+		if (++marquee_timer < MARQUEE_PAUSE_FRAMES) return;
+		MarqueeRestore();
+		marquee_timer = 0;
+		marquee_state = MARQUEE_WAIT;
+		return;
+	default:
+		return;
+	}
+}
@@ -0,0 +1,22 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#ifndef MARQUEE_H_
+#define MARQUEE_H_
+
+#include "main.h"
+
+#define MARQUEE_STRIP_WIDTH 1024
+#define MARQUEE_HEIGHT 14 // same lines as ClearList() clears for a row
+#define MARQUEE_LEFT 28
+#define MARQUEE_RIGHT 232 // pixels are written in pairs, so both ends are even
+#define MARQUEE_DELAY_FRAMES 60
+#define MARQUEE_PAUSE_FRAMES 60
+
+void MarqueeSet(s8 row, ItemConfig *config);
+void MarqueeStop(void);
+void MarqueeStep(void);
+
+#endif
@@ -0,0 +1,153 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <gba_dma.h>
+#include <string.h>
+
+#include "main.h"
+#include "itemlist.h"
+#include "preview.h"
+
+typedef enum
+{
+	PREVIEW_OFF,
+	PREVIEW_WAIT,
+	PREVIEW_DECODE,
+	PREVIEW_SHOWN
+} PREVIEW_STATE;
+
+// The image is decompressed here a slice per frame; finished lines are copied to the displayed page right away
+EWRAM_BSS u8 preview_pixels[PREVIEW_WIDTH * PREVIEW_HEIGHT] __attribute__((aligned(4)));
+const PreviewsHeader *previews = NULL;
+const u8 *preview_source;
+u16 preview_done;
+u8 preview_flags;
+u8 preview_flag_bits;
+u8 preview_top;
+u8 preview_lines;
+u8 preview_timer;
+PREVIEW_STATE preview_state = PREVIEW_OFF;
+
+static void PreviewRestore(void)
+{
+	// The back page still holds what the image covers
+	for (u8 y = 0; y < preview_lines; y++)
+	{
+		u32 offset = (preview_top + y) * SCREEN_WIDTH + PREVIEW_LEFT;
+		dmaCopy((void *)AGB_VRAM + 0xA000 + offset, (void *)AGB_VRAM + offset, PREVIEW_WIDTH);
+	}
+	preview_lines = 0;
+}
+
+static BOOL PreviewDecode(u16 limit)
+{
+	// Resumable LZ77 decoder (GBA BIOS format); returns FALSE on broken data
+	const u8 *source = preview_source;
+	u16 done = preview_done;
+	while (done < limit)
+	{
+		if (preview_flag_bits == 0)
+		{
+			preview_flags = *source++;
+			preview_flag_bits = 8;
+		}
+		if (preview_flags & 0x80)
+		{
+			u8 length = (source[0] >> 4) + 3;
+			u16 distance = (((source[0] & 0xF) << 8) | source[1]) + 1;
+			source += 2;
+			if ((distance > done) || (done + length > PREVIEW_WIDTH * PREVIEW_HEIGHT))
+				return FALSE;
+			for (u8 i = 0; i < length; i++, done++)
+			{
+				preview_pixels[done] = preview_pixels[done - distance];
+			}
+		}
+		else
+		{
+			preview_pixels[done++] = *source++;
+		}
+		preview_flags <<= 1;
+		preview_flag_bits--;
+	}
+	_TRACE_ROM_READ(source - preview_source);
+	preview_source = source;
+	preview_done = done;
+	return TRUE;
+}
+
+static void PreviewDraw(void)
+{
+	for (; preview_lines < preview_done / PREVIEW_WIDTH; preview_lines++)
+	{
+		u32 offset = (preview_top + preview_lines) * SCREEN_WIDTH + PREVIEW_LEFT;
+		dmaCopy(&preview_pixels[preview_lines * PREVIEW_WIDTH], (void *)AGB_VRAM + offset, PREVIEW_WIDTH);
+	}
+}
+
+void PreviewInit(void)
+{
+	const PreviewsHeader *header = (const PreviewsHeader *)ItemListGetPreviews();
+	_TRACE_ROM_READ(sizeof(PreviewsHeader));
+	previews = NULL;
+	if ((header == NULL) || (header->magic != MAGIC_PREVIEWS) || (header->version != 1))
+		return;
+	if ((header->width != PREVIEW_WIDTH) || (header->height != PREVIEW_HEIGHT))
+		return;
+	previews = header;
+}
+
+void PreviewSet(s8 row, ItemConfig *config)
+{
+	// Decompression starts once the cursor has rested on the game for a moment
+	PreviewStop();
+	if ((previews == NULL) || (config->preview >= previews->count))
+		return;
+	const u32 *offsets = (const u32 *)(previews + 1);
+	const u8 *source = (const u8 *)previews + offsets[config->preview];
+	_TRACE_ROM_READ(4 + 4);
+	if ((source[0] != 0x10) || ((source[1] | (source[2] << 8) | (source[3] << 16)) != PREVIEW_WIDTH * PREVIEW_HEIGHT))
+		return;
+	preview_source = source + 4;
+	preview_done = 0;
+	preview_flag_bits = 0;
+	preview_top = (row < 4) ? PREVIEW_TOP_LOWER : PREVIEW_TOP_UPPER;
+	preview_timer = 0;
+	preview_state = PREVIEW_WAIT;
+}
+
+void PreviewStop(void)
+{
+	PreviewRestore();
+	preview_state = PREVIEW_OFF;
+}
+
+void PreviewStep(void)
+{
+	// Called once per frame during VBlank while no keys are held
+	switch (preview_state)
+	{
+	case PREVIEW_WAIT:
+		if (++preview_timer < PREVIEW_DELAY_FRAMES) return;
+		preview_state = PREVIEW_DECODE;
+		return;
+	case PREVIEW_DECODE:
+	{
+		u16 limit = preview_done + PREVIEW_STEP_BYTES;
+		if (limit > PREVIEW_WIDTH * PREVIEW_HEIGHT) limit = PREVIEW_WIDTH * PREVIEW_HEIGHT;
+		if (!PreviewDecode(limit))
+		{
+			PreviewStop();
+			return;
+		}
+		PreviewDraw();
+		if (preview_done == PREVIEW_WIDTH * PREVIEW_HEIGHT) preview_state = PREVIEW_SHOWN;
+		return;
+	}
+	default:
+		return;
+	}
+}
@@ -0,0 +1,36 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#ifndef PREVIEW_H_
+#define PREVIEW_H_
+
+#include "main.h"
+
+#define MAGIC_PREVIEWS 0x56504B4C
+#define PREVIEW_WIDTH 60
+#define PREVIEW_HEIGHT 40
+#define PREVIEW_LEFT 172 // right-aligned with the list; pixels are copied in pairs, so it has to be even
+#define PREVIEW_TOP_UPPER 27 // covers rows 0-2 while the cursor is in the lower half of the page
+#define PREVIEW_TOP_LOWER 99 // covers rows 5-7 while the cursor is in the upper half
+#define PREVIEW_DELAY_FRAMES 20
+#define PREVIEW_STEP_BYTES 600 // decompressed bytes per frame
+
+// Written by the ROM Builder, followed by a table of offsets to LZ77 data (BIOS format) relative to the header
+typedef struct PreviewsHeader_
+{
+    u32 magic;
+    u16 version;
+    u16 count;
+    u8 width;
+    u8 height;
+    u16 reserved;
+} PreviewsHeader;
+
+void PreviewInit(void);
+void PreviewSet(s8 row, ItemConfig *config);
+void PreviewStop(void);
+void PreviewStep(void);
+
+#endif
@@ -0,0 +1,121 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <gba_input.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "font.h"
+#include "profile.h"
+
+#ifdef RENDER_PROFILE
+
+extern FontSpecs sFontSpecs;
+extern s8 FontMarginBottom;
+extern const u8 *font;
+
+void ProfileTimerStart(void)
+{
+	REG_IME = 0;
+	REG_TM2CNT_H = 0;
+	REG_TM3CNT_H = 0;
+	REG_TM2CNT_L = 0;
+	REG_TM3CNT_L = 0;
+	REG_TM3CNT_H = 0x0084; // count up on timer 2 overflow
+	REG_TM2CNT_H = 0x0080; // 16.78 MHz, one tick per CPU cycle
+}
+
+u32 ProfileTimerStop(u32 calls)
+{
+	REG_TM2CNT_H = 0;
+	REG_TM3CNT_H = 0;
+	REG_IME = 1;
+	return ((REG_TM3CNT_L << 16) | REG_TM2CNT_L) / calls;
+}
+
+void RenderProfile(void)
+{
+	char temp_ascii[64];
+	u16 temp_unicode[64];
+	u16 sample[32];
+	u32 cycles[6];
+	const char *names[6] = {"SetPixel", "GetFontIndex", "GetFontWidths", "ClearList", "DrawText", "DrawText right"};
+	u8 width, advance;
+
+	LoadFont(0);
+	memset(sample, 0, sizeof(sample));
+	AsciiToUnicode("The quick brown fox jumps over", sample);
+	u8 sample_length = strlen("The quick brown fox jumps over");
+
+	ProfileTimerStart();
+	for (u16 i = 0; i < PROFILE_SETPIXEL_CALLS; i++)
+		SetPixel((void *)AGB_VRAM + 0xA000, 26 + (i & 0x3F), 28 + (i >> 6), 254);
+	cycles[0] = ProfileTimerStop(PROFILE_SETPIXEL_CALLS);
+
+	ProfileTimerStart();
+	for (u16 i = 0; i < PROFILE_FONT_CALLS; i++)
+		GetFontIndex(sample[i % sample_length], font);
+	cycles[1] = ProfileTimerStop(PROFILE_FONT_CALLS);
+
+	ProfileTimerStart();
+	for (u16 i = 0; i < PROFILE_FONT_CALLS; i++)
+		GetFontWidths(i & 0x3F, font, &width, &advance);
+	cycles[2] = ProfileTimerStop(PROFILE_FONT_CALLS);
+
+	ProfileTimerStart();
+	for (u16 i = 0; i < PROFILE_LIST_CALLS; i++)
+		ClearList((void *)AGB_VRAM + 0xA000, 27 + (i & 7) * 14, 14);
+	cycles[3] = ProfileTimerStop(PROFILE_LIST_CALLS);
+
+	ProfileTimerStart();
+	for (u16 i = 0; i < PROFILE_LIST_CALLS; i++)
+		DrawText(28, 26 + (i & 7) * 14, ALIGN_LEFT, sample, sample_length, font, (void *)AGB_VRAM + 0xA000, i & 1);
+	cycles[4] = ProfileTimerStop(PROFILE_LIST_CALLS);
+
+	ProfileTimerStart();
+	for (u16 i = 0; i < PROFILE_LIST_CALLS; i++)
+		DrawText(11, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_RIGHT, sample, 10, font, (void *)AGB_VRAM + 0xA000, FALSE);
+	cycles[5] = ProfileTimerStop(PROFILE_LIST_CALLS);
+
+	// Results as "<function> <cycles per call>", the format tools/iwram_budget reads
+	ClearList((void *)AGB_VRAM + 0xA000, 0, SCREEN_HEIGHT);
+	for (u8 i = 0; i < 6; i++)
+	{
+		sprintf(temp_ascii, "%s %lu", names[i], (unsigned long)cycles[i]);
+		memset(temp_unicode, 0, sizeof(temp_unicode));
+		AsciiToUnicode(temp_ascii, temp_unicode);
+		DrawText(14, 26 + i * 14, ALIGN_LEFT, temp_unicode, 48, font, (void *)AGB_VRAM + 0xA000, FALSE);
+	}
+#ifdef RENDER_IWRAM
+	AsciiToUnicode("Cycles per call (IWRAM, ARM)", temp_unicode);
+#else
+	AsciiToUnicode("Cycles per call (ROM, Thumb)", temp_unicode);
+#endif
+	DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, temp_unicode, 28, font, (void *)AGB_VRAM + 0xA000, FALSE);
+	REG_DISPCNT ^= 0x0010;
+	dmaCopy((void *)AGB_VRAM + 0xA000, (void *)AGB_VRAM, SCREEN_WIDTH * SCREEN_HEIGHT);
+	REG_DISPCNT = (REG_DISPCNT ^ 0x0010) & ~LCDC_OFF;
+
+	// Wait for a key press, then go back to the menu
+	do
+	{
+		VBlankIntrWait();
+		scanKeys();
+	} while (keysHeld());
+	do
+	{
+		VBlankIntrWait();
+		scanKeys();
+	} while (!keysHeld());
+	do
+	{
+		VBlankIntrWait();
+		scanKeys();
+	} while (keysHeld());
+}
+
+#endif
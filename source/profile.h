@@ -0,0 +1,17 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#ifndef PROFILE_H_
+#define PROFILE_H_
+
+#include "main.h"
+
+#define PROFILE_SETPIXEL_CALLS 1024
+#define PROFILE_FONT_CALLS 256
+#define PROFILE_LIST_CALLS 16
+
+void RenderProfile(void);
+
+#endif
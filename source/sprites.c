@@ -0,0 +1,144 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <gba_video.h>
+#include <string.h>
+
+#include "main.h"
+#include "font.h"
+#include "sprites.h"
+
+extern FontSpecs sFontSpecs;
+extern u16 ArrowCharacter;
+extern s8 FontMarginBottom;
+extern const u8 *font;
+
+// Glyphs are rasterized once with DrawText into this buffer, which has the same layout as a Mode 4 page
+EWRAM_BSS u16 sprite_scratch[SCREEN_WIDTH * SPRITE_HEIGHT / 2];
+u8 sprite_glyph_width[SPRITE_GLYPH_COUNT];
+u8 sprite_counter_y;
+u16 sprite_counter_value[2] = {0xFFFF, 0xFFFF};
+
+void SpritesSetObj(u8 number, s16 x, s16 y, u8 glyph)
+{
+	vu16 *oam = (vu16 *)AGB_OAM + number * 4;
+	if (glyph >= SPRITE_GLYPH_COUNT)
+	{
+		oam[0] = 0x0200; // hidden
+		return;
+	}
+	oam[0] = 0x8000 | 0x2000 | (y & 0xFF); // tall shape, 256 colors
+	oam[1] = 0x8000 | (x & 0x1FF);		   // 16x32
+	oam[2] = 512 + glyph * SPRITE_TILES;   // tiles below 512 overlap the bitmap
+}
+
+void SpritesRenderGlyph(u8 glyph, u16 ch)
+{
+	u16 text[1] = {ch};
+	memset(sprite_scratch, 0, sizeof(sprite_scratch));
+	DrawText(0, 0, ALIGN_LEFT, text, 1, font, sprite_scratch, FALSE);
+	sprite_glyph_width[glyph] = GetGlyphWidth(ch, font);
+
+	// Convert the top left 16x32 pixels into 8x8 tiles in 1D order
+	vu16 *tiles = (vu16 *)AGB_OBJ_VRAM + glyph * SPRITE_TILES * 16;
+	_TRACE_VRAM_WRITE(tiles, SPRITE_TILES * 32);
+	u8 *pixels = (u8 *)sprite_scratch;
+	for (u8 ty = 0; ty < SPRITE_HEIGHT / 8; ty++)
+	{
+		for (u8 tx = 0; tx < SPRITE_WIDTH / 8; tx++)
+		{
+			for (u8 y = 0; y < 8; y++)
+			{
+				u8 *row = pixels + (ty * 8 + y) * SCREEN_WIDTH + tx * 8;
+				for (u8 x = 0; x < 8; x += 2)
+				{
+					*tiles++ = row[x] | (row[x + 1] << 8);
+				}
+			}
+		}
+	}
+}
+
+void SpritesInit(void)
+{
+	// Hide all sprites
+	for (u8 i = 0; i < 128; i++)
+	{
+		SpritesSetObj(i, 0, 0, 0xFF);
+	}
+
+	// Text colors, same as the background's
+	for (u16 i = 240; i < 256; i++)
+	{
+		((vu16 *)AGB_OBJ_PRAM)[i] = ((vu16 *)AGB_PRAM)[i];
+	}
+	((vu16 *)AGB_OBJ_PRAM)[0] = 0;
+
+	LoadFont(1);
+	SpritesRenderGlyph(SPRITE_GLYPH_ARROW, ArrowCharacter);
+	LoadFont(2);
+	for (u8 i = 0; i < 10; i++)
+	{
+		SpritesRenderGlyph(i, '0' + i);
+	}
+	SpritesRenderGlyph(10, '/');
+	sprite_counter_y = SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom;
+
+	REG_DISPCNT |= OBJ_ENABLE | OBJ_1D_MAP;
+}
+
+void SpritesSetCursor(s8 row)
+{
+	if (row < 0)
+	{
+		SpritesSetObj(0, 0, 0, 0xFF);
+		return;
+	}
+	SpritesSetObj(0, 14, 26 + row * 14, SPRITE_GLYPH_ARROW);
+}
+
+void SpritesSetCounter(u16 position, u16 total)
+{
+	// "position/total", right-aligned like the status bar text it replaces
+	u8 glyphs[SPRITE_COUNTER_LENGTH];
+	u8 length = 0;
+	u8 width = 0;
+	if ((position == sprite_counter_value[0]) && (total == sprite_counter_value[1]))
+		return;
+	sprite_counter_value[0] = position;
+	sprite_counter_value[1] = total;
+
+	for (u16 value = total; ; value /= 10)
+	{
+		glyphs[length++] = value % 10;
+		if (value < 10) break;
+	}
+	glyphs[length++] = 10;
+	for (u16 value = position; ; value /= 10)
+	{
+		glyphs[length++] = value % 10;
+		if (value < 10) break;
+	}
+
+	for (u8 i = 0; i < length; i++)
+	{
+		width += sprite_glyph_width[glyphs[i]];
+	}
+	s16 x = SCREEN_WIDTH - width - 11 + 1;
+	for (u8 i = 0; i < SPRITE_COUNTER_LENGTH; i++)
+	{
+		if (i < length)
+		{
+			u8 glyph = glyphs[length - 1 - i];
+			SpritesSetObj(SPRITE_COUNTER_FIRST + i, x, sprite_counter_y, glyph);
+			x += sprite_glyph_width[glyph];
+		}
+		else
+		{
+			SpritesSetObj(SPRITE_COUNTER_FIRST + i, 0, 0, 0xFF);
+		}
+	}
+}
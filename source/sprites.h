@@ -0,0 +1,27 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#ifndef SPRITES_H_
+#define SPRITES_H_
+
+#include "main.h"
+
+#define AGB_OAM (volatile void *)0x7000000
+#define AGB_OBJ_VRAM (volatile void *)0x6014000 // OBJ tiles that remain usable in bitmap modes
+#define AGB_OBJ_PRAM (volatile void *)0x5000200
+
+#define SPRITE_WIDTH 16
+#define SPRITE_HEIGHT 32
+#define SPRITE_TILES 16 // 16x32 pixels at 8 bpp, in 32 byte units
+#define SPRITE_GLYPH_ARROW 11
+#define SPRITE_GLYPH_COUNT 12 // digits, slash, arrow
+#define SPRITE_COUNTER_FIRST 1
+#define SPRITE_COUNTER_LENGTH 9
+
+void SpritesInit(void);
+void SpritesSetCursor(s8 row);
+void SpritesSetCounter(u16 position, u16 total);
+
+#endif
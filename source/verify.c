@@ -0,0 +1,206 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <gba_input.h>
+#include <gba_dma.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "main.h"
+#include "font.h"
+#include "verify.h"
+#include "itemlist.h"
+
+extern FontSpecs sFontSpecs;
+extern s8 FontMarginBottom;
+extern const u8 *font;
+extern u8 *itemlist;
+
+void VerifyFlip(void)
+{
+	REG_DISPCNT ^= 0x0010;
+	dmaCopy((void *)AGB_VRAM + 0xA000, (void *)AGB_VRAM, SCREEN_WIDTH * SCREEN_HEIGHT);
+	REG_DISPCNT = (REG_DISPCNT ^ 0x0010) & ~LCDC_OFF;
+}
+
+void VerifyDrawStatus(char *left, char *right)
+{
+	u16 temp_unicode[64];
+
+	LoadFont(0);
+	ClearList((void *)AGB_VRAM + 0xA000, SCREEN_HEIGHT - sFontSpecs.max_height - 1, sFontSpecs.max_height);
+	memset(temp_unicode, 0, sizeof(temp_unicode));
+	AsciiToUnicode(left, temp_unicode);
+	DrawText(5, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_LEFT, temp_unicode, 48, font, (void *)AGB_VRAM + 0xA000, FALSE);
+	memset(temp_unicode, 0, sizeof(temp_unicode));
+	AsciiToUnicode(right, temp_unicode);
+	DrawText(11, SCREEN_HEIGHT - sFontSpecs.max_height - 3 - FontMarginBottom, ALIGN_RIGHT, temp_unicode, 24, font, (void *)AGB_VRAM + 0xA000, FALSE);
+}
+
+void VerifyDrawLine(u8 line, char *prefix, VerifyEntry *entry)
+{
+	u16 temp_unicode[64];
+	ItemConfig config;
+
+	memset(temp_unicode, 0, sizeof(temp_unicode));
+	AsciiToUnicode(prefix, temp_unicode);
+	u8 length = strlen(prefix);
+	if (entry != NULL && entry->type == VERIFY_ROM)
+	{
+		ItemListGet(entry->index, &config);
+		for (u8 i = 0; i < config.title_length && length < 63; i++)
+		{
+			temp_unicode[length++] = config.title[i];
+		}
+	}
+	LoadFont(0);
+	ClearList((void *)AGB_VRAM + 0xA000, 27 + line * 14, 14);
+	DrawText(14, 26 + line * 14, ALIGN_LEFT, temp_unicode, length, font, (void *)AGB_VRAM + 0xA000, entry != NULL && entry->type != VERIFY_SAVE);
+}
+
+u32 VerifyTimerRead(void)
+{
+	u16 hi = REG_TM3CNT_L;
+	u16 lo = REG_TM2CNT_L;
+	if (hi != REG_TM3CNT_L)
+	{
+		hi = REG_TM3CNT_L;
+		lo = REG_TM2CNT_L;
+	}
+	return (hi << 16) | lo;
+}
+
+void VerifyFormatSpeed(char *output, u32 bytes, u32 ticks)
+{
+	// Timer ticks at 16.78 MHz / 1024
+	u32 rate = 0;
+	if (ticks > 0)
+		rate = (u32)(((unsigned long long)bytes * 16384 * 100) / ticks / (1024 * 1024));
+	sprintf(output, "%lu.%02lu MB/s", (unsigned long)(rate / 100), (unsigned long)(rate % 100));
+}
+
+void VerifyCartridge(void)
+{
+	char temp_ascii[64];
+	char temp_speed[24];
+	VerifyManifestHeader header;
+	VerifyEntry entry;
+	u8 lines = 0;
+	u16 bad = 0;
+	u16 changed = 0;
+
+	ClearList((void *)AGB_VRAM + 0xA000, 26, 14 * 8 + 1);
+	memcpy(&header, itemlist + VERIFY_MANIFEST_OFFSET, sizeof(header));
+	if (header.magic != MAGIC_VERIFY_MANIFEST || header.version != 1)
+	{
+		VerifyDrawLine(0, "No checksums found on this cartridge.", NULL);
+		VerifyDrawLine(1, "Please rebuild it with the latest ROM Builder.", NULL);
+		VerifyDrawStatus("Verification unavailable", "");
+		VerifyFlip();
+	}
+	else
+	{
+		// Total amount of data to check
+		u32 total = 0;
+		for (u16 i = 0; i < header.count; i++)
+		{
+			memcpy(&entry, itemlist + VERIFY_MANIFEST_OFFSET + sizeof(header) + i * sizeof(entry), sizeof(entry));
+			total += entry.length;
+		}
+
+		VerifyDrawLine(lines++, "Verifying cartridge...", NULL);
+		VerifyFlip();
+
+		Crc32Init();
+		REG_TM2CNT_H = 0;
+		REG_TM3CNT_H = 0;
+		REG_TM2CNT_L = 0;
+		REG_TM3CNT_L = 0;
+		REG_TM3CNT_H = 0x0084; // count up on timer 2 overflow
+		REG_TM2CNT_H = 0x0083; // 16.78 MHz / 1024
+
+		u32 done = 0;
+		for (u16 i = 0; i < header.count; i++)
+		{
+			memcpy(&entry, itemlist + VERIFY_MANIFEST_OFFSET + sizeof(header) + i * sizeof(entry), sizeof(entry));
+
+			// Check in slices so progress can be shown in between
+			u32 crc = 0xFFFFFFFF;
+			for (u32 pos = 0; pos < entry.length; pos += VERIFY_SLICE_SIZE)
+			{
+				u32 size = entry.length - pos;
+				if (size > VERIFY_SLICE_SIZE)
+					size = VERIFY_SLICE_SIZE;
+				crc = VerifyCrcRegion(crc, entry.offset + pos, size);
+				done += size;
+
+				sprintf(temp_ascii, "Checking %d/%d (%lu%%)", i + 1, header.count, (unsigned long)(((unsigned long long)done * 100) / total));
+				VerifyFormatSpeed(temp_speed, done, VerifyTimerRead());
+				VerifyDrawStatus(temp_ascii, temp_speed);
+				VerifyFlip();
+			}
+			crc = ~crc;
+
+			if (crc == entry.crc32)
+				continue;
+
+			// Save data is expected to change after playing, so it's listed but not counted as an error
+			if (entry.type == VERIFY_SAVE)
+			{
+				changed++;
+				sprintf(temp_ascii, "Save slot %d changed", entry.index + 1);
+			}
+			else
+			{
+				bad++;
+				if (entry.type == VERIFY_MENU)
+					sprintf(temp_ascii, "BAD: Menu ROM");
+				else if (entry.type == VERIFY_ITEMLIST)
+					sprintf(temp_ascii, "BAD: Game list");
+				else
+					sprintf(temp_ascii, "BAD: ");
+			}
+			if (lines < 7)
+			{
+				VerifyDrawLine(lines++, temp_ascii, &entry);
+			}
+			else if (lines == 7)
+			{
+				VerifyDrawLine(lines++, "...", NULL);
+			}
+		}
+
+		u32 ticks = VerifyTimerRead();
+		REG_TM2CNT_H = 0;
+		REG_TM3CNT_H = 0;
+
+		sprintf(temp_ascii, "Verification finished in %lu s", (unsigned long)(ticks / 16384));
+		VerifyDrawLine(0, temp_ascii, NULL);
+		if (lines == 1)
+			VerifyDrawLine(lines++, "All checksums match.", NULL);
+		sprintf(temp_ascii, "OK: %d | Bad: %d | Changed: %d", header.count - bad - changed, bad, changed);
+		VerifyFormatSpeed(temp_speed, done, ticks);
+		VerifyDrawStatus(temp_ascii, temp_speed);
+		VerifyFlip();
+	}
+
+	// Wait for a key press, then go back to the menu
+	do
+	{
+		VBlankIntrWait();
+		scanKeys();
+	} while (keysHeld());
+	do
+	{
+		VBlankIntrWait();
+		scanKeys();
+	} while (!keysHeld());
+	do
+	{
+		VBlankIntrWait();
+		scanKeys();
+	} while (keysHeld());
+}
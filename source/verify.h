@@ -0,0 +1,47 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#ifndef VERIFY_H_
+#define VERIFY_H_
+
+#include "main.h"
+
+#define MAGIC_VERIFY_MANIFEST 0x46564B4C
+#define VERIFY_MANIFEST_OFFSET 0x10000 // within the item list sector
+#define VERIFY_BUFFER_SIZE 0x1000
+#define VERIFY_SLICE_SIZE 0x40000
+
+typedef enum
+{
+    VERIFY_MENU,
+    VERIFY_ITEMLIST,
+    VERIFY_ROM,
+    VERIFY_SAVE
+} VERIFY_TYPE;
+
+typedef struct VerifyManifestHeader_
+{
+    u32 magic;
+    u16 version;
+    u16 count;
+    u8 reserved[8];
+} VerifyManifestHeader;
+
+typedef struct VerifyEntry_
+{
+    u8 type;
+    u8 reserved;
+    u16 index; // item list record for ROMs, slot for saves
+    u32 offset;
+    u32 length;
+    u32 crc32;
+} VerifyEntry;
+
+IWRAM_CODE void Crc32Init(void);
+IWRAM_CODE u32 Crc32Update(u32 crc, const u8 *data, u32 length);
+IWRAM_CODE u32 VerifyCrcRegion(u32 crc, u32 offset, u32 length);
+void VerifyCartridge(void);
+
+#endif
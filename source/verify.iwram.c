@@ -0,0 +1,89 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#include <gba.h>
+#include <gba_dma.h>
+
+#include "main.h"
+#include "verify.h"
+
+// Slicing-by-4 tables, kept in IWRAM together with the code
+u32 crc32_table[4][256];
+u32 verify_buffer[VERIFY_BUFFER_SIZE / 4];
+
+IWRAM_CODE void Crc32Init(void)
+{
+	for (u32 i = 0; i < 256; i++)
+	{
+		u32 crc = i;
+		for (u32 j = 0; j < 8; j++)
+		{
+			crc = (crc >> 1) ^ ((crc & 1) ? 0xEDB88320 : 0);
+		}
+		crc32_table[0][i] = crc;
+	}
+	for (u32 i = 0; i < 256; i++)
+	{
+		for (u32 k = 1; k < 4; k++)
+		{
+			u32 crc = crc32_table[k - 1][i];
+			crc32_table[k][i] = (crc >> 8) ^ crc32_table[0][crc & 0xFF];
+		}
+	}
+}
+
+IWRAM_CODE u32 Crc32Update(u32 crc, const u8 *data, u32 length)
+{
+	const u32 *p = (const u32 *)data;
+	for (u32 i = length >> 2; i > 0; i--)
+	{
+		crc ^= *p++;
+		crc = crc32_table[3][crc & 0xFF] ^ crc32_table[2][(crc >> 8) & 0xFF] ^ crc32_table[1][(crc >> 16) & 0xFF] ^ crc32_table[0][crc >> 24];
+	}
+	data = (const u8 *)p;
+	for (u32 i = length & 3; i > 0; i--)
+	{
+		crc = crc32_table[0][(crc ^ *data++) & 0xFF] ^ (crc >> 8);
+	}
+	return crc;
+}
+
+IWRAM_CODE void VerifySelectBank(u32 bank)
+{
+	// Map a full 32 MiB flash bank, bank 0 holds the menu ROM
+	*(vu8 *)MAPPER_CONFIG1 = (bank & 0xF) << 4;
+	*(vu8 *)MAPPER_CONFIG2 = 0x40;
+	*(vu8 *)MAPPER_CONFIG3 = 0;
+
+	u32 timeout = 0x2FFF;
+	while (((((vu16 *)AGB_ROM)[0x58] == 0x4B4C) != (bank == 0)) && timeout--)
+		;
+}
+
+IWRAM_CODE u32 VerifyCrcRegion(u32 crc, u32 offset, u32 length)
+{
+	u32 bank = offset >> 25;
+	u8 *rom = (u8 *)(AGB_ROM + (offset & 0x1FFFFFF));
+
+	// The menu ROM isn't visible while another bank is mapped
+	vu16 ie = REG_IE;
+	REG_IE = ie & 0xFFFE;
+	if (bank != 0)
+		VerifySelectBank(bank);
+
+	while (length > 0)
+	{
+		u32 size = length < VERIFY_BUFFER_SIZE ? length : VERIFY_BUFFER_SIZE;
+		dmaCopy(rom, verify_buffer, (size + 3) & ~3);
+		crc = Crc32Update(crc, (u8 *)verify_buffer, size);
+		rom += size;
+		length -= size;
+	}
+
+	if (bank != 0)
+		VerifySelectBank(0);
+	REG_IE = ie;
+	return crc;
+}
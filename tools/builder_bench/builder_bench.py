@@ -0,0 +1,246 @@
+# -*- coding: utf-8 -*-
+# GBA Multi Game Menu – ROM Builder Benchmark
+# Author: Lesserkuma (github.com/lesserkuma)
+#
+# Generates synthetic ROM sets for each cartridge type, runs the ROM Builder on them
+# and writes a plain text report of the placement results that can be compared between
+# builder versions with a regular diff tool. Phase timings and peak memory vary between
+# runs and go into a separate report. Small placement cases are also checked against
+# the exhaustive optimum.
+
+import sys, os, json, random, shutil, subprocess, argparse, re, tempfile, ast, itertools
+
+builder_path = os.path.join(os.path.dirname(os.path.abspath(__file__)), "..", "..", "rom_builder", "rom_builder.py")
+flash_sizes = [0x4000000, 0x10000000, 0x8000000, 0x20000000]
+rom_sizes = [0x80000, 0x100000, 0x200000, 0x400000, 0x800000, 0x1000000, 0x2000000]
+rom_weights = [4, 6, 8, 10, 8, 4, 1]
+save_signatures = [b"SRAM_V113", b"SRAM_F_V100", b"FLASH_V126", b"FLASH512_V131", b"FLASH1M_V103", b"EEPROM_V124", b""]
+# Japanese, Chinese and Korean title words; all of them are covered by the default font
+cjk_words = ["ぼうけんのたび", "まもののせかい", "ドラゴンクエスト", "ファイナルパズル", "レース", "伝説", "物語", "冒険王国", "世界大戦争", "勇者", "魔法少女", "星空", "海賊", "忍者", "三国志戦記", "전설의 모험", "왕국", "세계", "용사", "마법", "별하늘"]
+
+################################
+
+def GenerateRomSet(path, cartridge_type, fill, seed):
+	# Deterministic set of ROMs with mixed sizes, save types, map_256m games, CJK titles and a few duplicates
+	rnd = random.Random(seed)
+	os.makedirs(os.path.join(path, "roms"), exist_ok=True)
+	filler = rnd.randbytes(0x100000)
+	games = []
+	total = 0
+	index = 0
+	while total < flash_sizes[cartridge_type - 1] * fill:
+		if index > 0 and rnd.random() < 0.05:
+			# Same ROM under a different name
+			source = rnd.choice(games)
+			file = f"rom{index:03d}.gba"
+			shutil.copyfile(os.path.join(path, "roms", source["file"]), os.path.join(path, "roms", file))
+			size = os.path.getsize(os.path.join(path, "roms", file))
+		else:
+			size = rnd.choices(rom_sizes, rom_weights)[0]
+			file = f"rom{index:03d}.gba"
+			header = bytearray(rnd.randbytes(0x200))
+			signature = rnd.choice(save_signatures)
+			header[0x100:0x100 + len(signature)] = signature
+			if rnd.random() < 0.03: header[0xAC:0xAF] = b"BPR"
+			with open(os.path.join(path, "roms", file), "wb") as f:
+				f.write(header)
+				pos = len(header)
+				while pos < size:
+					chunk = filler[(pos + index) % 0x1000:][:size - pos]
+					f.write(chunk)
+					pos += len(chunk)
+		title = f"Game {index:03d}"
+		if rnd.random() < 0.3:
+			title = " ".join(rnd.sample(cjk_words, rnd.randint(1, 3))) + f" {index:03d}"
+		game = {
+			"enabled": True,
+			"file": file,
+			"title": title,
+			"title_font": 1,
+			"save_slot": index + 1,
+		}
+		if size >= 0x1000000 and rnd.random() < 0.2: game["map_256m"] = True
+		if rnd.random() < 0.05: game["keys"] = ["L", "R"]
+		games.append(game)
+		total += size
+		index += 1
+	config = {
+		"cartridge": {
+			"type": cartridge_type,
+			"battery_present": True,
+			"min_rom_size": 0x80000,
+		},
+		"games": games,
+	}
+	with open(os.path.join(path, "config.json"), "w", encoding="UTF-8-SIG") as f:
+		f.write(json.dumps(obj=config, indent=4))
+	return (len(games), total)
+
+def RunBuilder(path, extra_args):
+	# Returns the builder's output and its peak resident memory in KiB
+	with open(os.path.join(path, "builder_output.txt"), "w+", encoding="UTF-8") as f:
+		# A fixed build timestamp keeps the menu sector the same between builds
+		env = dict(os.environ, SOURCE_DATE_EPOCH="1700000000")
+		process = subprocess.Popen([sys.executable, builder_path, "--no-wait", "--no-log", "--timings"] + extra_args, cwd=path, env=env, stdout=f, stderr=subprocess.STDOUT)
+		peak_rss = None
+		if hasattr(os, "wait4"):
+			(_, status, usage) = os.wait4(process.pid, 0)
+			process.returncode = os.waitstatus_to_exitcode(status)
+			peak_rss = usage.ru_maxrss if sys.platform != "darwin" else usage.ru_maxrss // 1024
+		else:
+			process.wait()
+		f.seek(0)
+		output = f.read()
+	if process.returncode != 0:
+		print(output)
+		raise RuntimeError(f"ROM Builder failed with exit code {process.returncode}")
+	return (output, peak_rss)
+
+def ParseOutput(output):
+	result = {"timings":{}}
+	for line in output.splitlines():
+		m = re.match(r"Added (\d+) ROM", line)
+		if m: result["added"] = int(m.group(1))
+		m = re.match(r"([\d.]+)% \((\d+) of (\d+) sectors\) used", line)
+		if m: result["sectors"] = f"{m.group(2)}/{m.group(3)}"
+		m = re.match(r"(\d+) ROM\(s\) share", line)
+		if m: result["shared"] = int(m.group(1))
+		m = re.match(r"Placement: (.*)", line)
+		if m: result["placement"] = m.group(1)
+		m = re.match(r"Output ROM Size: (.*)", line)
+		if m: result["output_size"] = m.group(1)
+		m = re.match(r"Delta: +(\d+) of", line)
+		if m: result["delta"] = int(m.group(1))
+		m = re.match(r"  (\S.*?) +([\d.]+) s$", line)
+		if m: result["timings"][m.group(1)] = float(m.group(2))
+	return result
+
+def LoadPlacement():
+	# Takes the placement functions from the ROM Builder without running the script itself
+	with open(builder_path, "r", encoding="UTF-8") as f:
+		tree = ast.parse(f.read())
+	tree.body = [node for node in tree.body if isinstance(node, ast.FunctionDef) and node.name in ("PlaceGames", "PlaceGamesGreedy", "PlaceSet", "FindPlacement")]
+	functions = {}
+	exec(compile(tree, builder_path, "exec"), functions)
+	return functions
+
+def Placeable(games, occupied, start):
+	# Exact check: tries every aligned offset for every game, largest alignment first
+	games = sorted(games, key=lambda game: (game["align"], game["sector_count"]), reverse=True)
+	occupied = bytearray(occupied)
+	def Place(k):
+		if k == len(games): return True
+		n = games[k]["sector_count"]
+		a = games[k]["align"]
+		for i in range(-(-start // a) * a, len(occupied) - n + 1, a):
+			if occupied.find(1, i, i + n) == -1:
+				occupied[i:i + n] = b"\x01" * n
+				if Place(k + 1): return True
+				occupied[i:i + n] = b"\x00" * n
+		return False
+	return Place(0)
+
+def PlacementCase(functions, rnd):
+	# Small flash with an unaligned start, 16 sector map_256m windows and more games than fit
+	window = 16
+	occupied = bytearray(64)
+	start = rnd.randint(1, 7)
+	occupied[:start] = b"\x01" * start
+	games = []
+	for index in range(rnd.randint(8, 12)):
+		n = rnd.choice([1, 2, 2, 4, 4, 8, 16])
+		align = max(n, window) if n < window and rnd.random() < 0.3 else n
+		games.append({"index":index, "sector_count":n, "align":align, "size":n})
+	def Score(indexes):
+		return (len(indexes), sum(game["sector_count"] for game in games if game["index"] in indexes))
+	optimum = (0, 0)
+	for count in range(len(games), 0, -1):
+		for subset in itertools.combinations(games, count):
+			if Score([game["index"] for game in subset]) > optimum and Placeable(subset, occupied, start):
+				optimum = Score([game["index"] for game in subset])
+		if optimum[0] > 0: break
+	fallback = functions["PlaceGamesGreedy"](games, occupied, start)
+	offsets = functions["FindPlacement"](games, occupied, start, fallback)
+	check = bytearray(occupied)
+	for game in games:
+		if game["index"] not in offsets: continue
+		i = offsets[game["index"]]
+		if i < start or i % game["align"] != 0 or check.find(1, i, i + game["sector_count"]) != -1 or i + game["sector_count"] > len(check):
+			raise RuntimeError(f"Invalid placement of game {game['index']:d} at sector {i:d}")
+		check[i:i + game["sector_count"]] = b"\x01" * game["sector_count"]
+	return (Score(offsets), optimum)
+
+################################
+
+parser = argparse.ArgumentParser(description="Runs the ROM Builder on synthetic ROM sets and writes a report")
+parser.add_argument("--types", type=str, default="1,2,3,4", help="cartridge types to benchmark")
+parser.add_argument("--fill", type=float, default=1.1, help="combined ROM size relative to the flash size")
+parser.add_argument("--seed", type=int, default=1, help="seed for the generated ROM sets")
+parser.add_argument("--menu", type=str, help="menu ROM to use instead of a dummy file")
+parser.add_argument("--workdir", type=str, help="directory for the generated files (default: temporary directory)")
+parser.add_argument("--placement-cases", type=int, default=200, help="number of small placement cases compared against the exhaustive optimum")
+parser.add_argument("--report", type=str, default="builder_bench_report.txt", help="sets the report file")
+parser.add_argument("--timings-report", type=str, default="builder_bench_timings.txt", help="sets the report file for phase timings and peak memory")
+args = parser.parse_args()
+
+workdir = args.workdir or tempfile.mkdtemp(prefix="builder_bench_")
+report = []
+report.append(f"ROM Builder benchmark (seed {args.seed:d}, fill {args.fill:.2f})")
+timings = []
+timings.append(f"ROM Builder benchmark timings (seed {args.seed:d}, fill {args.fill:.2f})")
+if args.placement_cases > 0:
+	print("Comparing placements against the exhaustive optimum...")
+	functions = LoadPlacement()
+	rnd = random.Random(args.seed)
+	results = [PlacementCase(functions, rnd) for _ in range(args.placement_cases)]
+	report.append("")
+	report.append("[Placement with map_256m games and an unaligned start]")
+	report.append(f"cases             {len(results):d}")
+	report.append(f"optimal           {sum(1 for (score, optimum) in results if score == optimum):d}")
+	report.append(f"fewer roms        {sum(1 for (score, optimum) in results if score[0] < optimum[0]):d}")
+	report.append(f"fewer sectors     {sum(1 for (score, optimum) in results if score[0] == optimum[0] and score[1] < optimum[1]):d}")
+for cartridge_type in [int(x) for x in args.types.split(",")]:
+	path = os.path.join(workdir, f"type{cartridge_type:d}")
+	shutil.rmtree(path, ignore_errors=True)
+	os.makedirs(path)
+	if args.menu:
+		shutil.copyfile(args.menu, os.path.join(path, "lk_multimenu.gba"))
+	else:
+		with open(os.path.join(path, "lk_multimenu.gba"), "wb") as f:
+			f.write(random.Random(0).randbytes(0x30000) + b"dkARM\0\0\0")
+	print(f"Cartridge type {cartridge_type:d}: generating ROMs...")
+	(rom_count, rom_total) = GenerateRomSet(path, cartridge_type, args.fill, args.seed + cartridge_type)
+
+	print(f"Cartridge type {cartridge_type:d}: building...")
+	(output, peak_rss) = RunBuilder(path, ["--fresh-layout"])
+	build = ParseOutput(output)
+	(output, rebuild_peak_rss) = RunBuilder(path, [])
+	rebuild = ParseOutput(output)
+
+	report.append("")
+	report.append(f"[Cartridge type {cartridge_type:d}]")
+	report.append(f"input roms        {rom_count:d} ({rom_total // 0x100000:d} MiB)")
+	report.append(f"added roms        {build.get('added', 0):d}")
+	report.append(f"shared roms       {build.get('shared', 0):d}")
+	report.append(f"sectors used      {build.get('sectors', '?')}")
+	report.append(f"output size       {build.get('output_size', '?')}")
+	report.append(f"placement         {build.get('placement', 'everything fit')}")
+	report.append(f"rebuild delta     {rebuild.get('delta', 0):d} sector(s)")
+	
+	timings.append("")
+	timings.append(f"[Cartridge type {cartridge_type:d}]")
+	timings.append(f"peak rss          {peak_rss // 1024 if peak_rss else 0:d} MiB")
+	for (name, seconds) in build["timings"].items():
+		timings.append(f"time {name:<12s} {seconds:8.3f} s")
+	timings.append(f"rebuild peak rss  {rebuild_peak_rss // 1024 if rebuild_peak_rss else 0:d} MiB")
+	timings.append(f"rebuild total     {rebuild['timings'].get('total', 0):8.3f} s")
+	if not args.workdir: shutil.rmtree(path, ignore_errors=True)
+
+if not args.workdir: shutil.rmtree(workdir, ignore_errors=True)
+with open(args.report, "w", encoding="UTF-8") as f:
+	f.write("\n".join(report) + "\n")
+with open(args.timings_report, "w", encoding="UTF-8") as f:
+	f.write("\n".join(timings) + "\n")
+print("\n".join(report))
+print("")
+print("\n".join(timings))
@@ -0,0 +1,129 @@
+# -*- coding: utf-8 -*-
+# GBA Multi Game Menu – Emulator Boot Benchmark
+# Author: Lesserkuma (github.com/lesserkuma)
+#
+# Builds the menu, runs the ROM Builder on a directory of test ROMs and boots the
+# compilation in a headless emulator that runs menu_latency.lua. The measured frame
+# counts are written to a plain text report and compared against a baseline report.
+
+import sys, os, glob, json, shutil, subprocess, argparse, tempfile
+
+tool_path = os.path.dirname(os.path.abspath(__file__))
+repo_path = os.path.abspath(os.path.join(tool_path, "..", ".."))
+builder_path = os.path.join(repo_path, "rom_builder", "rom_builder.py")
+script_path = os.path.join(tool_path, "menu_latency.lua")
+
+################################
+
+def BuildMenu():
+	if "DEVKITARM" not in os.environ:
+		raise RuntimeError("DEVKITARM is not set; use --menu to pass a prebuilt menu ROM")
+	subprocess.run(["make"], cwd=repo_path, check=True)
+	return os.path.join(repo_path, os.path.basename(repo_path) + ".gba")
+
+def BuildCompilation(path, menu, roms, cartridge_type):
+	os.makedirs(os.path.join(path, "roms"), exist_ok=True)
+	shutil.copyfile(menu, os.path.join(path, "lk_multimenu.gba"))
+	files = sorted(glob.glob(os.path.join(roms, "*.gba")))
+	if len(files) == 0:
+		raise RuntimeError(f"No test ROMs found in {roms}")
+	games = []
+	for (index, file) in enumerate(files):
+		shutil.copyfile(file, os.path.join(path, "roms", os.path.basename(file)))
+		games.append({
+			"enabled": True,
+			"file": os.path.basename(file),
+			"title": os.path.splitext(os.path.basename(file))[0],
+			"title_font": 1,
+			"save_slot": index + 1,
+		})
+	config = {
+		"cartridge": {
+			"type": cartridge_type,
+			"battery_present": True,
+			"min_rom_size": 0x400000,
+		},
+		"games": games,
+	}
+	with open(os.path.join(path, "config.json"), "w", encoding="UTF-8-SIG") as f:
+		f.write(json.dumps(obj=config, indent=4))
+	subprocess.run([sys.executable, builder_path, "--no-wait", "--no-log", "--fresh-layout"], cwd=path, check=True, stdout=subprocess.DEVNULL)
+	output = glob.glob(os.path.join(path, "LK_MULTIMENU_*.gba"))
+	if len(output) != 1:
+		raise RuntimeError("ROM Builder didn't produce a compilation")
+	return (output[0], len(games))
+
+def RunEmulator(emulator, rom, timeout):
+	process = subprocess.run([emulator, "--script", script_path, rom], capture_output=True, text=True, timeout=timeout)
+	results = {}
+	for line in process.stdout.splitlines():
+		parts = line.split()
+		if len(parts) == 2: results[parts[0]] = parts[1]
+	if "done" not in results:
+		print(process.stdout + process.stderr)
+		raise RuntimeError("The benchmark script didn't finish")
+	del results["done"]
+	return results
+
+def ReadReport(file):
+	values = {}
+	with open(file, "r", encoding="UTF-8") as f:
+		for line in f.read().splitlines():
+			parts = line.split()
+			if len(parts) == 2: values[parts[0]] = parts[1]
+	return values
+
+################################
+
+parser = argparse.ArgumentParser(description="Measures menu boot and input latency in frames using a headless emulator")
+parser.add_argument("--roms", type=str, required=True, help="directory with the test ROMs (*.gba)")
+parser.add_argument("--menu", type=str, help="prebuilt menu ROM to use instead of running make")
+parser.add_argument("--emulator", type=str, default="mgba-headless", help="emulator executable that accepts --script")
+parser.add_argument("--type", type=int, default=1, help="cartridge type for the compilation")
+parser.add_argument("--runs", type=int, default=3, help="number of emulator runs; each value is the worst result")
+parser.add_argument("--timeout", type=int, default=300, help="seconds before an emulator run is aborted")
+parser.add_argument("--workdir", type=str, help="directory for the generated files (default: temporary directory)")
+parser.add_argument("--baseline", type=str, help="earlier report to compare the results against")
+parser.add_argument("--report", type=str, default="emu_bench_report.txt", help="sets the report file")
+args = parser.parse_args()
+
+if shutil.which(args.emulator) is None:
+	print(f"Emulator not found: {args.emulator}")
+	sys.exit(1)
+
+workdir = args.workdir or tempfile.mkdtemp(prefix="emu_bench_")
+menu = args.menu or BuildMenu()
+print("Building compilation...")
+(rom, rom_count) = BuildCompilation(workdir, menu, args.roms, args.type)
+
+results = {}
+for run in range(args.runs):
+	print(f"Emulator run {run + 1:d} of {args.runs:d}...")
+	for (name, value) in RunEmulator(args.emulator, rom, args.timeout).items():
+		# -1 means the event never happened and always wins
+		if name not in results or float(value) < 0 or (float(results[name]) >= 0 and float(value) > float(results[name])):
+			results[name] = value
+
+report = []
+report.append(f"# Emulator boot benchmark ({rom_count:d} ROMs, cartridge type {args.type:d}, {args.runs:d} runs, values in frames)")
+for (name, value) in results.items():
+	report.append(f"{name:<20s} {value}")
+with open(args.report, "w", encoding="UTF-8") as f:
+	f.write("\n".join(report) + "\n")
+print("\n".join(report))
+
+if not args.workdir: shutil.rmtree(workdir, ignore_errors=True)
+
+if args.baseline:
+	baseline = ReadReport(args.baseline)
+	regressions = 0
+	print("\nCompared to {:s}:".format(args.baseline))
+	for (name, value) in results.items():
+		if name not in baseline: continue
+		old = float(baseline[name])
+		new = float(value)
+		if old == new: continue
+		worse = (new < 0 <= old) or (new > old >= 0)
+		if worse: regressions += 1
+		print(f"{name:<20s} {baseline[name]:>8s} -> {value:<8s}{' (worse)' if worse else ''}")
+	sys.exit(1 if regressions > 0 else 0)
@@ -0,0 +1,147 @@
+-- GBA Multi Game Menu – Emulator Boot Benchmark
+-- Author: Lesserkuma (github.com/lesserkuma)
+--
+-- mGBA script that drives the menu with scripted key presses and prints frame counts
+-- as "name value" lines. Started by emu_bench.py; exits the emulator when done.
+
+local SCREEN_WIDTH = 240
+local VRAM = 0x06000000
+local ROM_LK_SIGNATURE = 0x080000B0
+local TIMEOUT = 1200
+
+local frame = 0
+local step = 1
+local mark = 0
+local before = nil
+local samples = {}
+local results = {}
+
+local function Output(name, value)
+	local line = string.format("%s %s", name, tostring(value))
+	if io and io.stdout then
+		io.stdout:write(line .. "\n")
+		io.stdout:flush()
+	else
+		console:log(line)
+	end
+end
+
+-- Sum of a rectangle of the displayed page, used to notice when the menu flips new content to it
+local function Checksum(x, y, width, height)
+	local sum = 0
+	for row = y, y + height - 1 do
+		local address = VRAM + row * SCREEN_WIDTH + x
+		for offset = 0, width - 1, 4 do
+			sum = (sum + emu:read32(address + offset) * (row + 1)) % 0x100000000
+		end
+	end
+	return sum
+end
+
+local function CursorArea() return emu:read16(0x07000000) end -- the arrow is sprite 0
+local function ListArea() return Checksum(28, 26, 208, 112) end
+local function MenuVisible()
+	-- The display stays off until the first page has been drawn
+	local dispcnt = emu:read16(0x04000000)
+	return (dispcnt & 0x0080) == 0 and (dispcnt & 0x0007) == 4
+end
+
+local function Finish()
+	for _, entry in ipairs(results) do Output(entry[1], entry[2]) end
+	Output("done", 1)
+	if os and os.exit then os.exit(0) end
+end
+
+local function Record(name, value)
+	table.insert(results, { name, value })
+end
+
+-- Presses a key for two frames and measures the frames until the watched area changes
+local function Measure(name, key, area, count)
+	return function()
+		local elapsed = frame - mark
+		if before == nil then
+			if elapsed < 30 then return false end -- let the key repeat timer settle
+			before = area()
+			emu:addKey(key)
+			mark = frame
+			return false
+		end
+		if elapsed == 2 then emu:clearKey(key) end
+		if area() ~= before or elapsed > TIMEOUT then
+			emu:clearKey(key)
+			table.insert(samples, elapsed > TIMEOUT and -1 or elapsed)
+			before = nil
+			mark = frame
+			if #samples < count then return false end
+			local min, max, total = samples[1], samples[1], 0
+			for _, v in ipairs(samples) do
+				if v < min then min = v end
+				if v > max then max = v end
+				total = total + v
+			end
+			Record(name .. "_min", min)
+			Record(name .. "_max", max)
+			Record(name .. "_avg", string.format("%.2f", total / #samples))
+			samples = {}
+			return true
+		end
+		return false
+	end
+end
+
+local steps = {
+	-- Reset to the first frame that shows the menu
+	function()
+		if MenuVisible() then
+			Record("first_menu_frame", frame)
+			mark = frame
+			return true
+		end
+		if frame > TIMEOUT then
+			Record("first_menu_frame", -1)
+			Finish()
+		end
+		return false
+	end,
+	Measure("cursor_down", C.GBA_KEY.DOWN, CursorArea, 6),
+	Measure("cursor_up", C.GBA_KEY.UP, CursorArea, 6),
+	Measure("page_next", C.GBA_KEY.RIGHT, ListArea, 4),
+	Measure("page_prev", C.GBA_KEY.LEFT, ListArea, 4),
+	Measure("sort_order", C.GBA_KEY.R, ListArea, 3),
+	-- A to the game's entry point: the mapper hides the menu's signature once the game is mapped in
+	function()
+		local elapsed = frame - mark
+		if before == nil then
+			if elapsed < 30 then return false end
+			before = 0
+			emu:addKey(C.GBA_KEY.A)
+			mark = frame
+			return false
+		end
+		if elapsed == 2 then emu:clearKey(C.GBA_KEY.A) end
+		if emu:read16(ROM_LK_SIGNATURE) ~= 0x4B4C then
+			local pc = emu:readRegister("pc")
+			if pc >= 0x08000000 and pc < 0x0A000000 then
+				Record("game_entry", elapsed)
+				return true
+			end
+		end
+		if elapsed > TIMEOUT then
+			Record("game_entry", -1)
+			return true
+		end
+		return false
+	end,
+}
+
+callbacks:add("frame", function()
+	frame = frame + 1
+	if step > #steps then return end
+	if steps[step]() then
+		step = step + 1
+		if step > #steps then Finish() end
+	end
+end)
+
+emu:reset()
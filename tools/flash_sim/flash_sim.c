@@ -0,0 +1,743 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Host-side flash chip simulator for source/flash.c.
+Runs the real flash driver against a simulated cartridge and reports
+simulated time, bus cycles and per-sector erase counts, and checks the
+menu's own wear record against them.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <getopt.h>
+
+#include <gba.h>
+
+#include "main.h"
+#include "flash.h"
+
+#define CPU_HZ 16777216ULL
+#define CYCLES_PER_FRAME 280896ULL
+#define CYCLES_PER_LINE 1232ULL
+#define CYCLES_WRITE 6 // ROM write with default waitstates plus nop
+#define CYCLES_READ 8  // ROM read with default waitstates plus loop overhead
+#define ROM_WINDOW 0x2000000
+#define MAX_SECTORS (ROM_WINDOW / 0x20000)
+#define US_TO_CYCLES(us) ((u64)(us) * CPU_HZ / 1000000ULL)
+
+extern u8 flash_type;
+extern u32 flash_sector_size;
+extern u32 flash_status_sector_offset;
+extern u32 flash_save_sector_offset;
+extern SaveWriteBack sSaveWriteBack;
+extern FlashWear flash_wear;
+
+typedef enum
+{
+	FAMILY_INTEL,
+	FAMILY_AMD
+} ChipFamily;
+
+typedef struct SimChip_
+{
+	const char *name;
+	u8 flash_type;
+	ChipFamily family;
+	u32 sector_size;
+	u16 id[2];
+	u16 unlock1;
+	u16 unlock2;
+	u16 cmd_autoselect;
+	u16 cmd_erase_setup;
+	u16 cmd_sector_erase;
+	u16 cmd_write_buffer;
+	u16 cmd_buffer_confirm;
+	u16 cmd_reset;
+	u32 erase_us;
+	u32 program_us;
+} SimChip;
+
+static const SimChip sim_chips[] = {
+	{"6600M0U0BE", 1, FAMILY_INTEL, 0x40000, {0x008A, 0x88B0}, 0, 0, 0x90, 0x20, 0xD0, 0xEA, 0xD0, 0xFF, 800000, 900},
+	{"MSP55LV100S", 2, FAMILY_AMD, 0x20000, {0x0102, 0x7E7D}, 0xAAA9, 0x5556, 0x9090, 0x8080, 0x3030, 0x2526, 0x292A, 0xF0F0, 500000, 240},
+	{"MSP54LV100", 3, FAMILY_AMD, 0x20000, {0x0002, 0x227D}, 0xA9, 0x56, 0x90, 0x80, 0x30, 0x26, 0x2A, 0xF0, 500000, 340},
+};
+
+typedef enum
+{
+	MODE_READ,
+	MODE_ID,
+	MODE_STATUS,
+	MODE_LOCK_SETUP,
+	MODE_ERASE_SETUP,
+	MODE_BUFFER_COUNT,
+	MODE_BUFFER_DATA,
+	MODE_BUFFER_CONFIRM,
+	MODE_ERASE_WINDOW
+} ChipMode;
+
+typedef struct SimState_
+{
+	const SimChip *chip;
+	ChipMode mode;
+	u8 unlock_step;
+	BOOL erase_unlocked;
+	u64 cycles;
+	u64 busy_until;
+	u64 erase_window_end;
+	BOOL busy_erase;
+	u16 toggle;
+	u16 last_data;
+	u32 buffer_address;
+	u32 buffer_words;
+	u32 buffer_count;
+	u32 buffer_pa[512];
+	u16 buffer_pd[512];
+	u32 erase_counts[MAX_SECTORS];
+	u32 pending_erase[MAX_SECTORS];
+	u32 pending_erase_count;
+	u64 writes;
+	u64 reads;
+	u64 programmed_bytes;
+	u32 protocol_errors;
+	u32 soft_resets;
+} SimState;
+
+static SimState sim;
+
+static void SimError(const char *message, u32 address, u16 data)
+{
+	sim.protocol_errors++;
+	if (sim.protocol_errors <= 10)
+	{
+		fprintf(stderr, "Protocol error: %s (address 0x%06X, data 0x%04X)\n", message, address, data);
+	}
+}
+
+static BOOL SimBusy(void)
+{
+	return sim.cycles < sim.busy_until;
+}
+
+static void SimEraseSector(u32 address)
+{
+	u32 sector = address / sim.chip->sector_size;
+	memset((void *)(AGB_ROM + sector * sim.chip->sector_size), 0xFF, sim.chip->sector_size);
+	sim.erase_counts[sector]++;
+}
+
+static void SimProgramBuffer(void)
+{
+	for (u32 i = 0; i < sim.buffer_count; i++)
+	{
+		vu16 *cell = (vu16 *)(AGB_ROM + sim.buffer_pa[i]);
+		if ((*cell & sim.buffer_pd[i]) != sim.buffer_pd[i])
+		{
+			SimError("programming bits that are not erased", sim.buffer_pa[i], sim.buffer_pd[i]);
+		}
+		*cell &= sim.buffer_pd[i];
+	}
+	sim.last_data = sim.buffer_pd[sim.buffer_count - 1];
+	sim.programmed_bytes += sim.buffer_count * 2;
+	sim.busy_erase = FALSE;
+	sim.busy_until = sim.cycles + US_TO_CYCLES(sim.chip->program_us);
+}
+
+static void SimBufferWrite(u32 pa, u16 pd)
+{
+	if (sim.buffer_count >= 512 || (pa / 0x400) != (sim.buffer_address / 0x400))
+	{
+		SimError("write buffer address out of range", pa, pd);
+		return;
+	}
+	sim.buffer_pa[sim.buffer_count] = pa;
+	sim.buffer_pd[sim.buffer_count] = pd;
+	sim.buffer_count++;
+}
+
+static void SimIntelWrite(u32 pa, u16 pd)
+{
+	const SimChip *chip = sim.chip;
+	switch (sim.mode)
+	{
+	case MODE_LOCK_SETUP:
+		if (pd != 0xD0 && pd != 0x01)
+			SimError("invalid block lock command", pa, pd);
+		sim.mode = MODE_STATUS;
+		return;
+	case MODE_ERASE_SETUP:
+		if (pd != chip->cmd_sector_erase)
+		{
+			SimError("erase not confirmed", pa, pd);
+			sim.mode = MODE_STATUS;
+			return;
+		}
+		SimEraseSector(pa);
+		sim.busy_erase = TRUE;
+		sim.busy_until = sim.cycles + US_TO_CYCLES(chip->erase_us);
+		sim.mode = MODE_STATUS;
+		return;
+	case MODE_BUFFER_COUNT:
+		sim.buffer_words = (pd & 0x3FF) + 1;
+		sim.buffer_count = 0;
+		sim.mode = MODE_BUFFER_DATA;
+		return;
+	case MODE_BUFFER_DATA:
+		SimBufferWrite(pa, pd);
+		if (sim.buffer_count == sim.buffer_words)
+			sim.mode = MODE_BUFFER_CONFIRM;
+		return;
+	case MODE_BUFFER_CONFIRM:
+		if (pd != chip->cmd_buffer_confirm)
+			SimError("buffered program not confirmed", pa, pd);
+		else
+			SimProgramBuffer();
+		sim.mode = MODE_STATUS;
+		return;
+	default:
+		break;
+	}
+
+	switch (pd)
+	{
+	case 0xFF:
+		sim.mode = MODE_READ;
+		break;
+	case 0x90:
+		sim.mode = MODE_ID;
+		break;
+	case 0x70:
+	case 0x50:
+		sim.mode = MODE_STATUS;
+		break;
+	case 0x60:
+		sim.mode = MODE_LOCK_SETUP;
+		break;
+	case 0x20:
+		sim.mode = MODE_ERASE_SETUP;
+		break;
+	case 0xEA:
+	case 0xE8:
+		sim.buffer_address = pa;
+		sim.mode = MODE_BUFFER_COUNT;
+		break;
+	default:
+		// Unknown commands (e.g. probes for other chips) are ignored
+		break;
+	}
+}
+
+static void SimAmdStartErase(void)
+{
+	for (u32 i = 0; i < sim.pending_erase_count; i++)
+	{
+		SimEraseSector(sim.pending_erase[i]);
+	}
+	sim.busy_erase = TRUE;
+	sim.busy_until = sim.erase_window_end + US_TO_CYCLES(sim.chip->erase_us) * sim.pending_erase_count;
+	sim.pending_erase_count = 0;
+	sim.mode = MODE_READ;
+}
+
+static void SimAmdWrite(u32 pa, u16 pd)
+{
+	const SimChip *chip = sim.chip;
+
+	if (sim.mode == MODE_ERASE_WINDOW)
+	{
+		if (sim.cycles < sim.erase_window_end && pd == chip->cmd_sector_erase)
+		{
+			// Additional sectors within the erase timeout are erased in the same operation
+			sim.pending_erase[sim.pending_erase_count++] = pa;
+			sim.erase_window_end = sim.cycles + US_TO_CYCLES(50);
+			return;
+		}
+		SimAmdStartErase();
+	}
+
+	switch (sim.mode)
+	{
+	case MODE_BUFFER_COUNT:
+		if (pa != sim.buffer_address)
+			SimError("write buffer count written to wrong address", pa, pd);
+		sim.buffer_words = (pd & 0xFF) + 1;
+		sim.buffer_count = 0;
+		sim.mode = MODE_BUFFER_DATA;
+		return;
+	case MODE_BUFFER_DATA:
+		SimBufferWrite(pa, pd);
+		if (sim.buffer_count == sim.buffer_words)
+			sim.mode = MODE_BUFFER_CONFIRM;
+		return;
+	case MODE_BUFFER_CONFIRM:
+		if (pd != chip->cmd_buffer_confirm)
+			SimError("write buffer not confirmed", pa, pd);
+		else
+			SimProgramBuffer();
+		sim.mode = MODE_READ;
+		return;
+	default:
+		break;
+	}
+
+	if (pd == chip->cmd_reset)
+	{
+		sim.mode = MODE_READ;
+		sim.unlock_step = 0;
+		sim.erase_unlocked = FALSE;
+		return;
+	}
+
+	if (sim.unlock_step == 0)
+	{
+		if (pa == 0xAAA && pd == chip->unlock1)
+			sim.unlock_step = 1;
+		else
+			sim.erase_unlocked = FALSE;
+		return;
+	}
+	if (sim.unlock_step == 1)
+	{
+		sim.unlock_step = (pa == 0x555 && pd == chip->unlock2) ? 2 : 0;
+		return;
+	}
+
+	sim.unlock_step = 0;
+	if (sim.erase_unlocked)
+	{
+		sim.erase_unlocked = FALSE;
+		if (pd == chip->cmd_sector_erase)
+		{
+			sim.pending_erase[0] = pa;
+			sim.pending_erase_count = 1;
+			sim.erase_window_end = sim.cycles + US_TO_CYCLES(50);
+			sim.mode = MODE_ERASE_WINDOW;
+		}
+		else
+		{
+			SimError("unsupported erase command", pa, pd);
+		}
+		return;
+	}
+	if (pa == 0xAAA && pd == chip->cmd_autoselect)
+	{
+		sim.mode = MODE_ID;
+	}
+	else if (pa == 0xAAA && pd == chip->cmd_erase_setup)
+	{
+		sim.erase_unlocked = TRUE;
+	}
+	else if (pd == chip->cmd_write_buffer)
+	{
+		sim.buffer_address = pa;
+		sim.mode = MODE_BUFFER_COUNT;
+	}
+	else
+	{
+		SimError("unknown command after unlock", pa, pd);
+	}
+}
+
+void SimFlashWrite(u32 pa, u16 pd)
+{
+	sim.cycles += CYCLES_WRITE;
+	sim.writes++;
+	if (pa >= ROM_WINDOW)
+	{
+		SimError("write outside of the ROM window", pa, pd);
+		return;
+	}
+	if (SimBusy())
+	{
+		SimError("write while the chip is busy", pa, pd);
+		return;
+	}
+	if (sim.chip->family == FAMILY_INTEL)
+		SimIntelWrite(pa, pd);
+	else
+		SimAmdWrite(pa, pd);
+}
+
+u16 SimFlashRead(u32 pa)
+{
+	sim.cycles += CYCLES_READ;
+	sim.reads++;
+	if (sim.mode == MODE_ERASE_WINDOW && sim.cycles >= sim.erase_window_end)
+	{
+		SimAmdStartErase();
+	}
+	BOOL busy = SimBusy() || sim.mode == MODE_ERASE_WINDOW;
+
+	if (sim.chip->family == FAMILY_INTEL)
+	{
+		if (sim.mode == MODE_READ)
+			return *(vu16 *)(AGB_ROM + pa);
+		if (sim.mode == MODE_ID)
+			return sim.chip->id[(pa >> 1) & 1];
+		return busy ? 0x00 : 0x80;
+	}
+
+	if (busy)
+	{
+		// DQ6 toggles on every read, DQ7 is the complement of the data being programmed
+		sim.toggle ^= 0x4040;
+		if (sim.busy_erase || sim.mode == MODE_ERASE_WINDOW)
+			return sim.toggle;
+		return (~sim.last_data & 0x8080) | sim.toggle;
+	}
+	if (sim.mode == MODE_ID)
+		return sim.chip->id[(pa >> 1) & 1];
+	return *(vu16 *)(AGB_ROM + pa);
+}
+
+void SimSoftReset(void)
+{
+	sim.soft_resets++;
+}
+
+u16 SimVCount(void)
+{
+	sim.cycles += CYCLES_READ;
+	return (sim.cycles % CYCLES_PER_FRAME) / CYCLES_PER_LINE;
+}
+
+u32 SimFlashTimer(void)
+{
+	// Timers 0 and 1 as set up by FlashInit()
+	return sim.cycles / (CPU_HZ / FLASH_TIMER_HZ);
+}
+
+void SystemCall(int number)
+{
+	if (number == 5)
+	{
+		// VBlankIntrWait
+		if (!(REG_IE & 1))
+			SimError("VBlankIntrWait with VBlank interrupt disabled", 0, REG_IE);
+		sim.cycles = (sim.cycles / CYCLES_PER_FRAME + 1) * CYCLES_PER_FRAME;
+	}
+	else if (number == 0)
+	{
+		sim.soft_resets++;
+	}
+}
+
+const unsigned int bgBitmap[9600];
+const unsigned short bgPal[256];
+
+static double CyclesToMs(u64 cycles)
+{
+	return cycles * 1000.0 / CPU_HZ;
+}
+
+static void SimReset(const SimChip *chip)
+{
+	memset(&sim, 0, sizeof(sim));
+	sim.chip = chip;
+	memset((void *)AGB_ROM, 0xFF, ROM_WINDOW);
+	REG_IE = 1;
+	REG_IME = 1;
+	flash_type = 0;
+	memset(&flash_wear, 0, sizeof(flash_wear));
+}
+
+static void FillRandom(volatile u8 *buffer, u32 length, u32 *seed)
+{
+	for (u32 i = 0; i < length; i++)
+	{
+		*seed = *seed * 1103515245 + 12345;
+		buffer[i] = *seed >> 16;
+	}
+}
+
+static void Usage(const char *name)
+{
+	printf("Usage: %s [options]\n", name);
+	printf("  --chip NAME        6600M0U0BE, MSP55LV100S or MSP54LV100 (default: all)\n");
+	printf("  --erase-us N       sector erase latency in microseconds\n");
+	printf("  --program-us N     write buffer program latency in microseconds\n");
+	printf("  --boots N          number of simulated game launches (default: 8)\n");
+}
+
+static void RunChip(const SimChip *chip_template, s32 erase_us, s32 program_us, u32 boots)
+{
+	SimChip chip = *chip_template;
+	if (erase_us >= 0)
+		chip.erase_us = erase_us;
+	if (program_us >= 0)
+		chip.program_us = program_us;
+	SimReset(&chip);
+
+	printf("Chip:              %s (type %d), %d KiB sectors, erase %.1f ms, buffer program %d us\n", chip.name, chip.flash_type, chip.sector_size >> 10, chip.erase_us / 1000.0, chip.program_us);
+
+	// Detection
+	u64 start = sim.cycles;
+	FlashDetectType();
+	printf("FlashDetectType:   type %d in %.3f ms\n", flash_type, CyclesToMs(sim.cycles - start));
+	if (flash_type != chip.flash_type)
+	{
+		printf("Error: Expected type %d\n", chip.flash_type);
+		sim.protocol_errors++;
+	}
+
+	// Single sector erase and program
+	u32 seed = 1;
+	u32 address = flash_save_sector_offset * flash_sector_size;
+	start = sim.cycles;
+	FlashEraseSector(address);
+	printf("FlashEraseSector:  %.2f ms\n", CyclesToMs(sim.cycles - start));
+	static u8 buffer[SRAM_SIZE];
+	FillRandom(buffer, SRAM_SIZE, &seed);
+	start = sim.cycles;
+	FlashWriteData(address, buffer, SRAM_SIZE);
+	printf("FlashWriteData:    64 KiB in %.2f ms\n", CyclesToMs(sim.cycles - start));
+	if (memcmp((void *)(AGB_ROM + address), buffer, SRAM_SIZE) != 0)
+	{
+		printf("Error: Programmed data doesn't match\n");
+		sim.protocol_errors++;
+	}
+
+	// Game launches, rotating through games with different save sizes
+	static const SAVE_TYPE save_types[] = {SRAM_512K, SRAM_256K, SRAM_NONE, SRAM_1M};
+	static u8 sram_expected[4][SRAM_SIZE];
+	FlashStatus status;
+	memset(&status, 0, sizeof(status));
+	status.magic = MAGIC_FLASH_STATUS;
+	status.battery_present = 1;
+	status.last_boot_menu_index = 0xFFFF;
+	status.last_boot_save_index = 0xFF;
+	status.last_boot_save_type = SRAM_NONE;
+	memset(sram_expected, 0xFF, sizeof(sram_expected));
+	memset((void *)AGB_SRAM, 0, SRAM_SIZE);
+	for (u32 i = 0; i < 4; i++)
+	{
+		FlashEraseSector((flash_save_sector_offset + i) * flash_sector_size);
+	}
+	memset(sim.erase_counts, 0, sizeof(sim.erase_counts));
+	SaveRegisterBackup();
+
+	// Every other launch lets the menu compare the previous save while idle first; launch times are
+	// kept apart by idle compare and by whether the previous game changed its save
+	u64 boot_cycles[2][2] = {{0, 0}, {0, 0}};
+	u32 boot_count[2][2] = {{0, 0}, {0, 0}};
+	u32 idle_frames = 0;
+	u32 save_errors = 0;
+	u32 save_writes = 0;
+	BOOL save_changed = FALSE;
+	for (u32 n = 0; n < boots; n++)
+	{
+		u32 game = n % 4;
+		ItemConfig config;
+		memset(&config, 0, sizeof(config));
+		config.save_type = save_types[game];
+		config.save_index = game;
+		status.last_boot_menu_index = game;
+
+		// Some boots run the verification mode, whose bank switches overwrite SRAM bytes 2~4
+		if (n % 3 == 1)
+		{
+			*(vu8 *)MAPPER_CONFIG1 = (n & 0xF) << 4;
+			*(vu8 *)MAPPER_CONFIG2 = 0x40;
+			*(vu8 *)MAPPER_CONFIG3 = 0;
+			*(vu8 *)MAPPER_CONFIG1 = 0;
+		}
+
+		u32 background = n & 1;
+		if (background)
+		{
+			SaveWriteBackStart(&status);
+			while (1)
+			{
+				BOOL more = SaveWriteBackStep();
+				idle_frames++;
+				if (!more)
+					break;
+				SystemCall(5);
+			}
+		}
+
+		if (save_changed)
+			save_writes++;
+		start = sim.cycles;
+		u8 result = BootGame(config, status);
+		boot_cycles[background][save_changed] += sim.cycles - start;
+		boot_count[background][save_changed]++;
+		sSaveWriteBack.state = WRITEBACK_IDLE;
+		REG_IE = 1;
+		if (result != 3)
+		{
+			printf("Error: BootGame() returned %d\n", result);
+			sim.protocol_errors++;
+			break;
+		}
+
+		// The game must see its own save data
+		u32 size = GetSaveSize(config.save_type);
+		if (memcmp((void *)AGB_SRAM, sram_expected[game], size) != 0)
+			save_errors++;
+
+		// Play the game; every third one doesn't save, so its slot must not be written again
+		save_changed = (size > 0) && (n % 3 != 2);
+		if (save_changed)
+		{
+			FillRandom(AGB_SRAM, size, &seed);
+			memcpy(sram_expected[game], (void *)AGB_SRAM, size);
+		}
+
+		// Menu reads the status record on the next boot, using the cached chip type
+		flash_type = 0;
+		SaveRegisterBackup();
+		start = sim.cycles;
+		FlashInit(&status);
+		if (n == 0)
+			printf("FlashInit:         type %d in %.3f ms (cached)\n", flash_type, CyclesToMs(sim.cycles - start));
+		if (status.magic != MAGIC_FLASH_STATUS || status.last_boot_save_index != game)
+		{
+			printf("Error: Status record wasn't written\n");
+			sim.protocol_errors++;
+			break;
+		}
+		if (flash_type != chip.flash_type || status.flash_type != chip.flash_type)
+		{
+			printf("Error: Cached chip type wasn't used\n");
+			sim.protocol_errors++;
+			break;
+		}
+	}
+	// A power cycle without a game launch must not erase anything
+	if (sim.protocol_errors == 0)
+	{
+		u32 erases[MAX_SECTORS];
+		memcpy(erases, sim.erase_counts, sizeof(erases));
+		SaveWriteBackStart(&status);
+		while (SaveWriteBackStep())
+			SystemCall(5);
+		sSaveWriteBack.state = WRITEBACK_IDLE;
+		flash_type = 0;
+		FlashInit(&status);
+		if (memcmp(erases, sim.erase_counts, sizeof(erases)) != 0)
+		{
+			printf("Error: The menu erased a sector without a game launch\n");
+			sim.protocol_errors++;
+		}
+	}
+
+	printf("BootGame:          avg ms from A press to game (launches), SRAM compare reads aren't timed\n");
+	for (u32 changed = 0; changed < 2; changed++)
+	{
+		printf("  %s", changed ? "changed save:  " : "unchanged save:");
+		for (u32 background = 0; background < 2; background++)
+		{
+			if (boot_count[background][changed] > 0)
+				printf(" %9.2f (%d) %s", CyclesToMs(boot_cycles[background][changed] / boot_count[background][changed]), boot_count[background][changed], background ? "after idle" : "cold");
+			else
+				printf("         - (0) %s", background ? "after idle" : "cold");
+			printf(background ? "\n" : ",");
+		}
+	}
+	u32 boot_total = boot_count[0][0] + boot_count[0][1] + boot_count[1][0] + boot_count[1][1];
+	if (boot_count[1][0] + boot_count[1][1] > 0)
+		printf("  idle compare:    avg %d frames\n", idle_frames / (boot_count[1][0] + boot_count[1][1]));
+	u32 save_erases = 0;
+	for (u32 i = 0; i < 4; i++)
+		save_erases += sim.erase_counts[flash_save_sector_offset + i];
+	printf("Save write-backs:  %d of %d launches, %d sector erases\n", save_writes, boot_total, save_erases);
+	if (save_erases != save_writes)
+	{
+		printf("Error: Save sectors were erased for unchanged saves\n");
+		sim.protocol_errors++;
+	}
+	printf("Save integrity:    %s\n", save_errors ? "FAILED" : "OK");
+	sim.protocol_errors += save_errors;
+	printf("Bus cycles:        %llu writes, %llu reads, %llu bytes programmed\n", (unsigned long long)sim.writes, (unsigned long long)sim.reads, (unsigned long long)sim.programmed_bytes);
+	printf("Wear record:       avg FlashEraseSector %.2f ms, avg FlashWriteData %.1f us\n",
+		   flash_wear.erase_count ? flash_wear.erase_ticks * 1000.0 / FLASH_TIMER_HZ / flash_wear.erase_count : 0,
+		   flash_wear.program_count ? flash_wear.program_ticks * 1000000.0 / FLASH_TIMER_HZ / flash_wear.program_count : 0);
+	printf("Sector erase counts:                record\n");
+	for (u32 i = 0; i < ROM_WINDOW / chip.sector_size; i++)
+	{
+		if (sim.erase_counts[i] == 0)
+			continue;
+		const char *name = "";
+		s32 recorded = -1;
+		if (i == flash_status_sector_offset)
+		{
+			name = "status";
+			recorded = flash_wear.status_erases;
+		}
+		else if (i >= flash_save_sector_offset && i < flash_save_sector_offset + 4)
+		{
+			name = "save";
+			recorded = flash_wear.save_erases[i - flash_save_sector_offset];
+		}
+		if (recorded >= 0)
+			printf("  0x%07X %-7s %5d %15d\n", i * chip.sector_size, name, sim.erase_counts[i], recorded);
+		else
+			printf("  0x%07X %-7s %5d\n", i * chip.sector_size, name, sim.erase_counts[i]);
+		if (recorded >= 0 && recorded != (s32)sim.erase_counts[i])
+		{
+			printf("Error: Wear record doesn't match the erase count\n");
+			sim.protocol_errors++;
+		}
+	}
+	printf("Errors:            %d\n\n", sim.protocol_errors);
+}
+
+int main(int argc, char **argv)
+{
+	const char *chip_name = NULL;
+	s32 erase_us = -1;
+	s32 program_us = -1;
+	u32 boots = 8;
+	static const struct option options[] = {
+		{"chip", required_argument, 0, 'c'},
+		{"erase-us", required_argument, 0, 'e'},
+		{"program-us", required_argument, 0, 'p'},
+		{"boots", required_argument, 0, 'b'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0},
+	};
+	int opt;
+	while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'c':
+			chip_name = optarg;
+			break;
+		case 'e':
+			erase_us = atoi(optarg);
+			break;
+		case 'p':
+			program_us = atoi(optarg);
+			break;
+		case 'b':
+			boots = atoi(optarg);
+			break;
+		default:
+			Usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+
+	SimMapMemory();
+	u32 errors = 0;
+	BOOL found = FALSE;
+	for (u32 i = 0; i < sizeof(sim_chips) / sizeof(sim_chips[0]); i++)
+	{
+		if (chip_name != NULL && strcasecmp(chip_name, sim_chips[i].name) != 0)
+			continue;
+		found = TRUE;
+		RunChip(&sim_chips[i], erase_us, program_us, boots);
+		errors += sim.protocol_errors;
+	}
+	if (!found)
+	{
+		fprintf(stderr, "Error: Unknown chip \"%s\"\n", chip_name);
+		return 1;
+	}
+	return errors ? 1 : 0;
+}
@@ -0,0 +1,26 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Force-included before the menu sources so that flash.h routes all flash
+command cycles through the simulated chip.
+*/
+
+#ifndef SIM_HOOKS_H_
+#define SIM_HOOKS_H_
+
+#include <stdint.h>
+
+void SimFlashWrite(uint32_t address, uint16_t data);
+uint16_t SimFlashRead(uint32_t address);
+void SimSoftReset(void);
+uint16_t SimVCount(void);
+uint32_t SimFlashTimer(void);
+
+#define _FLASH_WRITE(pa, pd) SimFlashWrite((pa), (pd))
+#define _FLASH_READ(pa) SimFlashRead(pa)
+#define _SOFT_RESET() SimSoftReset()
+#define _READ_VCOUNT() SimVCount()
+#define _READ_FLASH_TIMER() SimFlashTimer()
+
+#endif
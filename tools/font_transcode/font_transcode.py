@@ -0,0 +1,141 @@
+# -*- coding: utf-8 -*-
+# GBA Multi Game Menu – Font Transcoder
+# Author: Lesserkuma (github.com/lesserkuma)
+#
+# Converts an NFTR font into the menu's glyph format (see source/font.h). Called by the
+# Makefile for every font in the fonts folder, so the menu never has to parse NFTR data.
+
+import sys, struct, argparse
+
+FONT_VERSION = 1
+
+################################
+
+def ReadNFTR(data):
+	# Returns the font metrics, the glyph bitmaps, the width table and the character map
+	if data[0:4] != b"RTFN":
+		raise ValueError("not an NFTR font")
+	nftr_version = data[0x06]
+	pos = struct.unpack_from("<H", data, 0x0C)[0]
+	(finf_size,) = struct.unpack_from("<I", data, pos + 4)
+	(offset_cwdh, offset_cmap) = struct.unpack_from("<II", data, pos + 20)
+	pos += finf_size
+	(cglp_size, max_width, max_height, bytes_per_char, _, bpp) = struct.unpack_from("<IBBHHB", data, pos + 4)
+	glyph_count = (cglp_size - 0x10) // bytes_per_char
+	glyphs = [data[pos + 0x10 + i * bytes_per_char:pos + 0x10 + (i + 1) * bytes_per_char] for i in range(glyph_count)]
+
+	(cwdh_size,) = struct.unpack_from("<I", data, offset_cwdh - 8 + 4)
+	widths = []
+	for i in range(glyph_count):
+		pos = offset_cwdh + 8 + i * 3
+		widths.append(tuple(data[pos:pos + 3]) if pos + 3 <= offset_cwdh - 8 + cwdh_size else (0, 0, 0))
+
+	# Earlier CMAP blocks win, like they did when the menu walked the chain itself
+	cmap = {}
+	pos = offset_cmap - 8
+	while 0 < pos < len(data):
+		(start_code, end_code, cmap_type, _, next_offset) = struct.unpack_from("<HHHHI", data, pos + 8)
+		pos += 20
+		if cmap_type == 0:
+			(index_offset,) = struct.unpack_from("<H", data, pos)
+			for ch in range(start_code, end_code + 1):
+				cmap.setdefault(ch, ch - start_code + index_offset)
+		elif cmap_type == 1:
+			for ch in range(start_code, end_code + 1):
+				(index,) = struct.unpack_from("<H", data, pos + (ch - start_code) * 2)
+				if index != 0xFFFF: cmap.setdefault(ch, index)
+		elif cmap_type == 2:
+			(count,) = struct.unpack_from("<H", data, pos)
+			for i in range(count):
+				(ch, index) = struct.unpack_from("<HH", data, pos + 2 + i * 4)
+				cmap.setdefault(ch, index)
+		pos = next_offset - 8
+	cmap = {ch:index for (ch, index) in cmap.items() if index < glyph_count}
+	return {"version":nftr_version, "max_width":max_width, "max_height":max_height, "bpp":bpp, "glyphs":glyphs, "widths":widths, "cmap":cmap}
+
+def GlyphRows(glyph, max_width, max_height, bpp):
+	# NFTR packs pixels MSB first without padding between rows; each row becomes an opaque mask
+	# and, for 2 bpp fonts, two planes with the color bits (pixel x is bit x of each)
+	bits = "".join(f"{b:08b}" for b in glyph)
+	rows = []
+	for y in range(max_height):
+		mask = 0
+		plane0 = 0
+		plane1 = 0
+		for x in range(max_width):
+			pos = (y * max_width + x) * bpp
+			value = bits[pos:pos + bpp].ljust(bpp, "0")
+			if bpp == 1:
+				if value == "1": mask |= 1 << x
+			else:
+				color = int(value[0]) | (int(value[1]) << 1)
+				if color != 0: mask |= 1 << x
+				if color & 1: plane0 |= 1 << x
+				if color & 2: plane1 |= 1 << x
+		rows.append((mask, plane0, plane1))
+	return rows
+
+def GlyphWidths(font, index, ch):
+	# Width used to decide where titles are cut off and the horizontal advance, as the menu computed them from CWDH
+	(left, glyph_width, advance) = font["widths"][index]
+	if left >= font["max_width"] or ch == 0x20: left = 0
+	width = (advance - left) & 0xFF
+	if glyph_width != 0: advance = width
+	if font["version"] == 1:
+		if advance == 0: advance = font["max_width"]
+		advance = (advance + 1) & 0xFF
+	return (width, advance)
+
+def Transcode(font):
+	max_width = font["max_width"]
+	max_height = font["max_height"]
+	bpp = font["bpp"]
+	if bpp not in (1, 2) or max_width > 16:
+		raise ValueError(f"unsupported font: {bpp:d} bpp, {max_width:d} pixels wide")
+	row_size = 2 if bpp == 1 else 6
+	glyph_size = 2 + max_height * row_size
+
+	# Two-level character map: 256 page numbers, then 256 glyph indices per used page
+	pages = [0xFFFF] * 256
+	page_data = bytearray()
+	for page in sorted(set(ch >> 8 for ch in font["cmap"])):
+		pages[page] = len(page_data) // 512
+		page_data += struct.pack("<256H", *[font["cmap"].get((page << 8) | i, 0xFFFF) for i in range(256)])
+
+	# The space is the only character whose width depends on the character rather than the glyph
+	space = font["cmap"].get(0x20)
+	glyph_data = bytearray()
+	for (index, glyph) in enumerate(font["glyphs"]):
+		glyph_data += bytes(GlyphWidths(font, index, 0x20 if index == space else None))
+		for (mask, plane0, plane1) in GlyphRows(glyph, max_width, max_height, bpp):
+			glyph_data += struct.pack("<H", mask) if bpp == 1 else struct.pack("<HHH", mask, plane0, plane1)
+
+	pages_offset = 32
+	map_offset = pages_offset + 512
+	glyphs_offset = map_offset + len(page_data)
+	header = b"LKFN" + struct.pack("<HBBBBHIIII", FONT_VERSION, bpp, max_width, max_height, row_size, glyph_size, len(font["glyphs"]), pages_offset, map_offset, glyphs_offset)
+	header += bytearray(32 - len(header))
+	output = header + struct.pack("<256H", *pages) + page_data + glyph_data
+	output += bytearray(-len(output) % 4)
+	return output
+
+################################
+
+parser = argparse.ArgumentParser(description="Converts an NFTR font into the menu's glyph format")
+parser.add_argument("input", type=str, help="NFTR font")
+parser.add_argument("output", type=str, help="transcoded font")
+parser.add_argument("--verbose", help="prints the size of the converted font", action="store_true", default=False)
+args = parser.parse_args()
+
+with open(args.input, "rb") as f:
+	data = f.read()
+try:
+	font = ReadNFTR(data)
+	output = Transcode(font)
+except (ValueError, struct.error) as e:
+	print(f"Error: Couldn’t convert {args.input:s}: {str(e):s}", file=sys.stderr)
+	sys.exit(1)
+with open(args.output, "wb") as f:
+	f.write(output)
+if args.verbose:
+	print(f"{args.input:s}: {len(font['glyphs']):d} glyphs, {len(font['cmap']):d} characters, {len(data):d} -> {len(output):d} bytes")
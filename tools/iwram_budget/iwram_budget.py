@@ -0,0 +1,156 @@
+# -*- coding: utf-8 -*-
+# GBA Multi Game Menu – Memory Budget Report
+# Author: Lesserkuma (github.com/lesserkuma)
+#
+# Reads the linker map and the compiler's stack usage files (*.su) of a menu build and
+# prints how IWRAM and EWRAM are spent, how much room is left for the stack, and the
+# speedup of the rendering functions when given the render profile of two builds.
+
+import sys, os, glob, re, argparse
+
+IWRAM_START = 0x03000000
+IWRAM_SIZE = 0x8000
+IWRAM_STACK_TOP = 0x03007F00 # user stack pointer set by crt0, IRQ/supervisor stacks live above it
+EWRAM_START = 0x02000000
+EWRAM_SIZE = 0x40000
+RENDER_FUNCTIONS = [ "SetPixel", "GetFontIndex", "GetFontWidths", "ClearList", "DrawText" ]
+
+################################
+
+def ParseMap(file):
+	# Returns output sections and symbols with their input section, sizes are derived from the next symbol
+	sections = []
+	symbols = []
+	inputs = []
+	output = None
+	pending = None
+	with open(file, "r", encoding="UTF-8", errors="replace") as f:
+		lines = f.read().splitlines()
+	start = 0
+	for (i, line) in enumerate(lines):
+		if line.startswith("Linker script and memory map"):
+			start = i + 1
+			break
+	for line in lines[start:]:
+		if pending is not None:
+			line = pending + " " + line.strip()
+			pending = None
+		if re.match(r"^\s?\.\S+$", line):
+			# Long section names are followed by address and size on the next line
+			pending = line
+			continue
+		m = re.match(r"^(\.\S+)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)", line)
+		if m:
+			output = { "name":m.group(1), "address":int(m.group(2), 16), "size":int(m.group(3), 16) }
+			sections.append(output)
+			continue
+		m = re.match(r"^ (\.\S+|COMMON)\s+0x([0-9a-f]+)\s+0x([0-9a-f]+)\s+(\S+)", line)
+		if m and output is not None:
+			inputs.append({ "section":output["name"], "name":m.group(1), "address":int(m.group(2), 16), "size":int(m.group(3), 16), "object":os.path.basename(m.group(4)) })
+			continue
+		m = re.match(r"^\s+0x([0-9a-f]+)\s+([A-Za-z_]\w*)$", line)
+		if m and len(inputs) > 0 and output is not None:
+			symbols.append({ "name":m.group(2), "address":int(m.group(1), 16), "input":inputs[-1] })
+
+	# Symbol sizes within their input section
+	for (i, symbol) in enumerate(symbols):
+		end = symbol["input"]["address"] + symbol["input"]["size"]
+		for other in symbols[i + 1:]:
+			if other["input"] is not symbol["input"]: break
+			if other["address"] > symbol["address"]:
+				end = other["address"]
+				break
+		symbol["size"] = max(0, end - symbol["address"])
+	return (sections, symbols)
+
+def ReadStackUsage(path):
+	# Lines look like "font.c:162:6:DrawText	48	dynamic"
+	usage = {}
+	for file in glob.glob(os.path.join(path, "*.su")):
+		with open(file, "r", encoding="UTF-8", errors="replace") as f:
+			for line in f.read().splitlines():
+				parts = line.split("\t")
+				if len(parts) != 3: continue
+				usage[parts[0].split(":")[-1]] = (int(parts[1]), parts[2])
+	return usage
+
+def ReadProfile(file):
+	# Render profile screen contents, one "<function> <cycles>" per line
+	values = {}
+	with open(file, "r", encoding="UTF-8") as f:
+		for line in f.read().splitlines():
+			m = re.match(r"^(.*\S)\s+(\d+)$", line.strip())
+			if m: values[m.group(1)] = int(m.group(2))
+	return values
+
+def InRegion(address, start, size):
+	return start <= address < start + size
+
+################################
+
+parser = argparse.ArgumentParser(description="Prints the IWRAM/EWRAM budget of a menu build")
+parser.add_argument("--map", type=str, required=True, help="linker map of the build")
+parser.add_argument("--build", type=str, help="build directory with the *.su stack usage files")
+parser.add_argument("--profile-rom", type=str, help="render profile of a RENDER_IWRAM=0 build")
+parser.add_argument("--profile-iwram", type=str, help="render profile of a RENDER_IWRAM=1 build")
+parser.add_argument("--top", type=int, default=12, help="number of largest symbols to list")
+args = parser.parse_args()
+
+(sections, symbols) = ParseMap(args.map)
+stack_usage = ReadStackUsage(args.build) if args.build else {}
+
+# IWRAM
+iwram_sections = [s for s in sections if InRegion(s["address"], IWRAM_START, IWRAM_SIZE) and s["size"] > 0]
+iwram_end = max([s["address"] + s["size"] for s in iwram_sections] + [IWRAM_START])
+print("IWRAM")
+for section in iwram_sections:
+	print(f"  {section['name']:<24s} 0x{section['address']:08X} {section['size']:8d} bytes")
+print(f"  {'used':<24s} {'':10s} {iwram_end - IWRAM_START:8d} of {IWRAM_SIZE:d} bytes")
+print(f"  {'left for the stack':<24s} {'':10s} {IWRAM_STACK_TOP - iwram_end:8d} bytes (up to 0x{IWRAM_STACK_TOP:08X})")
+iwram_symbols = sorted([s for s in symbols if InRegion(s["address"], IWRAM_START, IWRAM_SIZE)], key=lambda s: s["size"], reverse=True)
+for symbol in iwram_symbols[:args.top]:
+	print(f"    {symbol['name']:<30s} {symbol['size']:8d} bytes  {symbol['input']['object']}")
+
+# EWRAM
+ewram_sections = [s for s in sections if InRegion(s["address"], EWRAM_START, EWRAM_SIZE) and s["size"] > 0]
+ewram_end = max([s["address"] + s["size"] for s in ewram_sections] + [EWRAM_START])
+print("\nEWRAM")
+for section in ewram_sections:
+	print(f"  {section['name']:<24s} 0x{section['address']:08X} {section['size']:8d} bytes")
+print(f"  {'used':<24s} {'':10s} {ewram_end - EWRAM_START:8d} of {EWRAM_SIZE:d} bytes")
+ewram_symbols = sorted([s for s in symbols if InRegion(s["address"], EWRAM_START, EWRAM_SIZE)], key=lambda s: s["size"], reverse=True)
+for symbol in ewram_symbols[:args.top]:
+	print(f"    {symbol['name']:<30s} {symbol['size']:8d} bytes  {symbol['input']['object']}")
+
+# Rendering functions
+print("\nRendering functions")
+by_name = { s["name"]:s for s in symbols }
+for name in RENDER_FUNCTIONS:
+	if name not in by_name:
+		print(f"  {name:<16s} not found")
+		continue
+	symbol = by_name[name]
+	where = "IWRAM" if InRegion(symbol["address"], IWRAM_START, IWRAM_SIZE) else "ROM"
+	stack = stack_usage.get(name)
+	stack = f"{stack[0]:d} bytes stack ({stack[1]})" if stack else "stack unknown"
+	print(f"  {name:<16s} {where:<6s} {symbol['size']:6d} bytes  {stack}")
+print("  DrawText also keeps a line canvas of 240 × font height bytes (3840 bytes for 16 px fonts) on the stack.")
+
+# Stack
+if len(stack_usage) > 0:
+	print("\nLargest stack frames")
+	for (name, (size, kind)) in sorted(stack_usage.items(), key=lambda x: x[1][0], reverse=True)[:args.top]:
+		print(f"  {name:<30s} {size:6d} bytes ({kind})")
+
+# Speedup
+if args.profile_rom and args.profile_iwram:
+	rom = ReadProfile(args.profile_rom)
+	iwram = ReadProfile(args.profile_iwram)
+	print("\nCycles per call (ROM/Thumb -> IWRAM/ARM)")
+	for name in rom:
+		if name not in iwram or iwram[name] == 0: continue
+		print(f"  {name:<16s} {rom[name]:8d} -> {iwram[name]:8d}  {rom[name] / iwram[name]:5.2f}x")
+
+if iwram_end > IWRAM_STACK_TOP - 0x1000:
+	print("\nWarning: Less than 4 KiB of IWRAM left for the stack.")
+	sys.exit(1)
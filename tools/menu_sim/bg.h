@@ -0,0 +1,18 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Stand-in for the grit-generated background header. The simulator copies
+the background embedded in the loaded menu ROM into these arrays.
+*/
+
+#ifndef SIM_BG_H_
+#define SIM_BG_H_
+
+#define bgBitmapLen 38400
+#define bgPalLen 512
+
+extern unsigned int bgBitmap[9600];
+extern unsigned short bgPal[256];
+
+#endif
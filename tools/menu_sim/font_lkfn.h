@@ -0,0 +1,14 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Stand-in for the bin2o-generated font header. The simulator points
+font_lkfn at the font embedded in the loaded menu ROM.
+*/
+
+#ifndef SIM_FONT_LKFN_H_
+#define SIM_FONT_LKFN_H_
+
+extern const unsigned char *font_lkfn;
+
+#endif
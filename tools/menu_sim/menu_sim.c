@@ -0,0 +1,1070 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Host-side menu simulator for source/main.c.
+Runs the real menu loop against a compilation built by the ROM Builder,
+replays a script of key presses, records frames as PNG files and reports
+the work each step caused (VRAM bytes written, glyphs decoded, ROM bytes read).
+*/
+
+#define _GNU_SOURCE
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+#include <gba.h>
+#include <gba_video.h>
+#include <gba_interrupt.h>
+#include <gba_input.h>
+#include <gba_dma.h>
+
+#include "main.h"
+#include "flash.h"
+#include "font.h"
+#include "itemlist.h"
+
+#define ROM_WINDOW 0x2000000
+#define AGB_OBJ_VRAM_ADDRESS 0x06010000
+#define AGB_OAM_ADDRESS 0x07000000
+#define SCANLINES 228
+#define BOOT_TIMEOUT_FRAMES 600
+#define MAX_COMMANDS 1024
+#define MAX_LINE 192
+
+int MenuMain(void);
+
+typedef enum
+{
+	CMD_BOOT,
+	CMD_PRESS,
+	CMD_WAIT,
+	CMD_SNAP
+} CommandType;
+
+typedef struct SimCommand_
+{
+	CommandType type;
+	u16 keys;
+	u32 frames;
+	char text[128];
+} SimCommand;
+
+typedef struct SimCounters_
+{
+	u32 frames;
+	u64 vram;
+	u64 glyphs;
+	u64 rom;
+} SimCounters;
+
+typedef enum
+{
+	EXIT_DONE = 10,
+	EXIT_BOOT,
+	EXIT_RESET,
+	EXIT_LAUNCH
+} ExitReason;
+
+// Lives in shared memory so that it survives the process of a simulated power cycle
+typedef struct SimState_
+{
+	u32 command;
+	BOOL started;
+	BOOL booting;
+	BOOL reset;
+	u16 boot_keys;
+	SimCounters counters;
+	FlashStatus status;
+	char lines[MAX_COMMANDS][MAX_LINE];
+} SimState;
+
+static const char *key_names[] = {"A", "B", "SELECT", "START", "RIGHT", "LEFT", "UP", "DOWN", "R", "L"};
+
+static SimState *sim;
+static SimCommand commands[MAX_COMMANDS];
+static u32 command_count;
+static u32 loops_per_frame = 1000;
+static const char *frames_path;
+static u64 loops;
+static u16 keys_pressed;
+static u16 keys_latched;
+static u16 keys_previous;
+static IntFn irq_vcount;
+static u8 frame_rgb[SCREEN_WIDTH * SCREEN_HEIGHT * 3];
+static u32 crc32_table[256];
+
+// Menu data taken from the compilation, see LoadMenuData()
+const unsigned char *font_lkfn;
+unsigned int bgBitmap[9600];
+unsigned short bgPal[256];
+
+// Flash driver state normally owned by flash.c
+u8 flash_type;
+u8 *itemlist;
+u16 itemlist_start;
+u32 flash_sector_size;
+u32 flash_itemlist_sector_offset;
+u32 flash_status_sector_offset;
+u32 flash_save_sector_offset;
+FlashWear flash_wear;
+
+static void SimFrame(void);
+static void FinishCommand(const char *note);
+
+////////////////////////////////
+// Work counters
+
+void SimTraceVram(volatile void *address, u32 bytes)
+{
+	uintptr_t a = (uintptr_t)address;
+	if (a >= 0x06000000 && a < 0x06018000)
+		sim->counters.vram += bytes;
+}
+
+void SimTraceRom(u32 bytes)
+{
+	sim->counters.rom += bytes;
+}
+
+void SimTraceGlyph(u32 bytes)
+{
+	sim->counters.glyphs++;
+	sim->counters.rom += bytes;
+}
+
+static BOOL IsRomData(const void *address)
+{
+	// The background is part of the menu ROM on the real cartridge
+	uintptr_t a = (uintptr_t)address;
+	if (a >= 0x08000000 && a < 0x0A000000)
+		return TRUE;
+	if (a >= (uintptr_t)bgBitmap && a < (uintptr_t)bgBitmap + sizeof(bgBitmap))
+		return TRUE;
+	return a >= (uintptr_t)bgPal && a < (uintptr_t)bgPal + sizeof(bgPal);
+}
+
+////////////////////////////////
+// libgba replacements
+
+void irqInit(void)
+{
+	irq_vcount = NULL;
+	REG_IE = 0;
+	REG_IME = 1;
+}
+
+void irqSet(int mask, IntFn function)
+{
+	if (mask & IRQ_VCOUNT)
+		irq_vcount = function;
+}
+
+void irqEnable(int mask)
+{
+	REG_IE |= mask;
+}
+
+void irqDisable(int mask)
+{
+	REG_IE &= ~mask;
+}
+
+void dmaCopy(const void *source, void *dest, u32 size)
+{
+	SimTraceVram(dest, size);
+	if (IsRomData(source))
+		sim->counters.rom += size;
+	memcpy(dest, source, size);
+}
+
+static void SimUpdateVCount(void)
+{
+	// Frames start with VBlank, so the first part of every frame reads as lines 160 to 227
+	REG_VCOUNT = (SCREEN_HEIGHT + (loops % loops_per_frame) * SCANLINES / loops_per_frame) % SCANLINES;
+}
+
+void scanKeys(void)
+{
+	// Each call is one iteration of the menu loop, which is what its key repeat counts
+	loops++;
+	if (loops % loops_per_frame == 0)
+		SimFrame();
+	SimUpdateVCount();
+	keys_previous = keys_latched;
+	keys_latched = keys_pressed;
+}
+
+u16 keysHeld(void)
+{
+	return keys_latched;
+}
+
+u16 keysDown(void)
+{
+	return keys_latched & ~keys_previous;
+}
+
+void VBlankIntrWait(void)
+{
+	loops = (loops / loops_per_frame + 1) * loops_per_frame;
+	SimFrame();
+	SimUpdateVCount();
+}
+
+void SystemCall(int number)
+{
+	if (number == 0)
+	{
+		sim->reset = TRUE;
+		fflush(stdout);
+		_exit(EXIT_RESET);
+	}
+	if (number == 5)
+		VBlankIntrWait();
+}
+
+////////////////////////////////
+// Flash driver replacements; the compilation is read-only here
+
+void FlashInit(FlashStatus *status)
+{
+	itemlist = (u8 *)(AGB_ROM + flash_itemlist_sector_offset * flash_sector_size);
+	memcpy(status, (void *)(AGB_ROM + flash_status_sector_offset * flash_sector_size), sizeof(FlashStatus));
+	memcpy(&flash_wear, (void *)(AGB_ROM + flash_status_sector_offset * flash_sector_size + FLASH_WEAR_OFFSET), sizeof(FlashWear));
+	if (flash_wear.magic != MAGIC_FLASH_WEAR)
+		memset(&flash_wear, 0, sizeof(FlashWear));
+}
+
+void FlashTuneWaitstates(FlashStatus *status)
+{
+}
+
+void SaveRegisterBackup(void)
+{
+}
+
+void SaveWriteBackStart(FlashStatus *status)
+{
+}
+
+BOOL SaveWriteBackStep(void)
+{
+	return FALSE;
+}
+
+void SaveWriteBackCancel(void)
+{
+}
+
+static void Utf16ToUtf8(const u16 *text, u8 length, char *output, u32 size)
+{
+	u32 pos = 0;
+	for (u8 i = 0; i < length && text[i] != 0 && pos + 4 < size; i++)
+	{
+		u16 ch = text[i];
+		if (ch < 0x80)
+		{
+			output[pos++] = ch;
+		}
+		else if (ch < 0x800)
+		{
+			output[pos++] = 0xC0 | (ch >> 6);
+			output[pos++] = 0x80 | (ch & 0x3F);
+		}
+		else
+		{
+			output[pos++] = 0xE0 | (ch >> 12);
+			output[pos++] = 0x80 | ((ch >> 6) & 0x3F);
+			output[pos++] = 0x80 | (ch & 0x3F);
+		}
+	}
+	output[pos] = 0;
+}
+
+u8 BootGame(ItemConfig config, FlashStatus status)
+{
+	// Ends the simulated power cycle; the status record is written back by the parent process
+	char title[MAX_LINE / 2];
+	char note[MAX_LINE];
+	status.last_boot_save_index = config.save_index;
+	status.last_boot_save_type = config.save_type;
+	status.last_boot_list_start = itemlist_start;
+	status.flash_type = flash_type;
+	status.flash_type_check = ~flash_type;
+	sim->status = status;
+	Utf16ToUtf8(config.title, config.title_length, title, sizeof(title));
+	snprintf(note, sizeof(note), "launch=%u \"%s\"", status.last_boot_menu_index, title);
+	FinishCommand(note);
+	_exit(EXIT_LAUNCH);
+}
+
+////////////////////////////////
+// Frame rendering
+
+static u32 Rgb555ToRgb888(u16 color)
+{
+	u8 r = color & 0x1F;
+	u8 g = (color >> 5) & 0x1F;
+	u8 b = (color >> 10) & 0x1F;
+	return ((r << 3 | r >> 2) << 16) | ((g << 3 | g >> 2) << 8) | (b << 3 | b >> 2);
+}
+
+static void RenderSprites(u8 y, u16 *line)
+{
+	static const u8 sizes[3][4][2] = {
+		{{8, 8}, {16, 16}, {32, 32}, {64, 64}},
+		{{16, 8}, {32, 8}, {32, 16}, {64, 32}},
+		{{8, 16}, {8, 32}, {16, 32}, {32, 64}},
+	};
+	const vu16 *oam = (const vu16 *)AGB_OAM_ADDRESS;
+	const vu16 *obj_palette = (const vu16 *)0x05000200;
+	const vu8 *obj_vram = (const vu8 *)AGB_OBJ_VRAM_ADDRESS;
+
+	// Lower numbers are drawn on top
+	for (s16 number = 127; number >= 0; number--)
+	{
+		u16 attr0 = oam[number * 4];
+		u16 attr1 = oam[number * 4 + 1];
+		u16 attr2 = oam[number * 4 + 2];
+		if ((attr0 & 0x0300) == 0x0200 || (attr0 >> 14) == 3)
+			continue;
+		u8 width = sizes[attr0 >> 14][attr1 >> 14][0];
+		u8 height = sizes[attr0 >> 14][attr1 >> 14][1];
+		s16 top = attr0 & 0xFF;
+		if (top >= SCREEN_HEIGHT)
+			top -= 256;
+		s16 left = attr1 & 0x1FF;
+		if (left >= 256)
+			left -= 512;
+		if (y < top || y >= top + height)
+			continue;
+		BOOL colors256 = (attr0 & 0x2000) != 0;
+		u8 py = y - top;
+		if (attr1 & 0x2000)
+			py = height - 1 - py;
+		for (u8 px = 0; px < width; px++)
+		{
+			s16 x = left + px;
+			if (x < 0 || x >= SCREEN_WIDTH)
+				continue;
+			u8 tx = (attr1 & 0x1000) ? width - 1 - px : px;
+			u8 index;
+			if (colors256)
+			{
+				u32 tile = (attr2 & 0x3FF) + ((py / 8) * (width / 8) + tx / 8) * 2;
+				index = obj_vram[(tile * 32 + (py % 8) * 8 + tx % 8) & 0x7FFF];
+			}
+			else
+			{
+				u32 tile = (attr2 & 0x3FF) + (py / 8) * (width / 8) + tx / 8;
+				index = obj_vram[(tile * 32 + (py % 8) * 4 + (tx % 8) / 2) & 0x7FFF];
+				index = (tx & 1) ? index >> 4 : index & 0xF;
+				if (index)
+					index |= (attr2 >> 12) << 4;
+			}
+			if (index == 0)
+				continue;
+			line[x] = obj_palette[index];
+		}
+	}
+}
+
+static void RenderFrame(u8 *rgb)
+{
+	u16 dispcnt = REG_DISPCNT;
+	if (dispcnt & LCDC_OFF)
+	{
+		// Forced blank shows white
+		memset(rgb, 0xFF, SCREEN_WIDTH * SCREEN_HEIGHT * 3);
+		return;
+	}
+
+	u16 palette[256];
+	memcpy(palette, (void *)AGB_PRAM, sizeof(palette));
+	const u16 *hblank_source = NULL;
+	u16 hblank_count = 0;
+	u16 hblank_dest = 0;
+	u32 dma0cnt = REG_DMA0CNT;
+	if ((dma0cnt & DMA_ENABLE) && ((dma0cnt & DMA_SPECIAL) == DMA_HBLANK) && ((REG_DMA0DAD & 0xFF000000) == 0x05000000))
+	{
+		hblank_source = (const u16 *)(uintptr_t)REG_DMA0SAD;
+		hblank_count = dma0cnt & 0xFFFF;
+		hblank_dest = (REG_DMA0DAD & 0x1FF) / 2;
+	}
+
+	const u8 *page = (const u8 *)(AGB_VRAM + ((dispcnt & 0x0010) ? 0xA000 : 0));
+	for (u8 y = 0; y < SCREEN_HEIGHT; y++)
+	{
+		// The palette as the HBlank DMA has left it for this line
+		if (hblank_source != NULL && y > 0 && hblank_dest + hblank_count <= 256)
+			memcpy(&palette[hblank_dest], hblank_source + (y - 1) * hblank_count, hblank_count * 2);
+
+		u16 line[SCREEN_WIDTH];
+		for (u8 x = 0; x < SCREEN_WIDTH; x++)
+		{
+			line[x] = palette[0];
+			if (((dispcnt & 7) == 4) && (dispcnt & BG2_ENABLE))
+				line[x] = palette[page[y * SCREEN_WIDTH + x]];
+		}
+		if (dispcnt & OBJ_ENABLE)
+			RenderSprites(y, line);
+		for (u8 x = 0; x < SCREEN_WIDTH; x++)
+		{
+			u32 color = Rgb555ToRgb888(line[x]);
+			u8 *p = rgb + (y * SCREEN_WIDTH + x) * 3;
+			p[0] = color >> 16;
+			p[1] = color >> 8;
+			p[2] = color;
+		}
+	}
+}
+
+////////////////////////////////
+// PNG output without external libraries (stored deflate blocks)
+
+static void Crc32Init(void)
+{
+	for (u32 i = 0; i < 256; i++)
+	{
+		u32 c = i;
+		for (u8 k = 0; k < 8; k++)
+			c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : c >> 1;
+		crc32_table[i] = c;
+	}
+}
+
+static u32 Crc32Update(u32 crc, const u8 *data, u32 length)
+{
+	crc = ~crc;
+	for (u32 i = 0; i < length; i++)
+		crc = crc32_table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+	return ~crc;
+}
+
+static void PutBE32(u8 *p, u32 value)
+{
+	p[0] = value >> 24;
+	p[1] = value >> 16;
+	p[2] = value >> 8;
+	p[3] = value;
+}
+
+static void WriteChunk(FILE *f, const char *type, const u8 *data, u32 length)
+{
+	u8 header[8];
+	PutBE32(header, length);
+	memcpy(header + 4, type, 4);
+	u32 crc = Crc32Update(0, header + 4, 4);
+	crc = Crc32Update(crc, data, length);
+	u8 trailer[4];
+	PutBE32(trailer, crc);
+	fwrite(header, 1, 8, f);
+	fwrite(data, 1, length, f);
+	fwrite(trailer, 1, 4, f);
+}
+
+static BOOL WritePng(const char *file, const u8 *rgb)
+{
+	const u32 stride = SCREEN_WIDTH * 3 + 1;
+	const u32 raw_length = stride * SCREEN_HEIGHT;
+	u8 *raw = malloc(raw_length);
+	u8 *zlib = malloc(raw_length + raw_length / 0xFFFF * 5 + 16);
+	for (u32 y = 0; y < SCREEN_HEIGHT; y++)
+	{
+		raw[y * stride] = 0; // no filter
+		memcpy(raw + y * stride + 1, rgb + y * SCREEN_WIDTH * 3, SCREEN_WIDTH * 3);
+	}
+
+	u32 pos = 0;
+	u32 a = 1, b = 0;
+	zlib[pos++] = 0x78;
+	zlib[pos++] = 0x01;
+	for (u32 offset = 0; offset < raw_length; offset += 0xFFFF)
+	{
+		u16 length = (raw_length - offset > 0xFFFF) ? 0xFFFF : raw_length - offset;
+		zlib[pos++] = (offset + length == raw_length) ? 1 : 0;
+		zlib[pos++] = length & 0xFF;
+		zlib[pos++] = length >> 8;
+		zlib[pos++] = ~length & 0xFF;
+		zlib[pos++] = (u16)~length >> 8;
+		memcpy(zlib + pos, raw + offset, length);
+		pos += length;
+	}
+	for (u32 i = 0; i < raw_length; i++)
+	{
+		a = (a + raw[i]) % 65521;
+		b = (b + a) % 65521;
+	}
+	PutBE32(zlib + pos, (b << 16) | a);
+	pos += 4;
+
+	FILE *f = fopen(file, "wb");
+	if (f == NULL)
+	{
+		free(raw);
+		free(zlib);
+		return FALSE;
+	}
+	static const u8 signature[8] = {0x89, 'P', 'N', 'G', 0x0D, 0x0A, 0x1A, 0x0A};
+	u8 ihdr[13] = {0};
+	PutBE32(ihdr, SCREEN_WIDTH);
+	PutBE32(ihdr + 4, SCREEN_HEIGHT);
+	ihdr[8] = 8; // bit depth
+	ihdr[9] = 2; // truecolor
+	fwrite(signature, 1, sizeof(signature), f);
+	WriteChunk(f, "IHDR", ihdr, sizeof(ihdr));
+	WriteChunk(f, "IDAT", zlib, pos);
+	WriteChunk(f, "IEND", NULL, 0);
+	fclose(f);
+	free(raw);
+	free(zlib);
+	return TRUE;
+}
+
+////////////////////////////////
+// Script
+
+static BOOL ParseKeys(const char *text, u16 *keys)
+{
+	// Key names joined with "+", e.g. "SELECT+L"
+	char buffer[64];
+	snprintf(buffer, sizeof(buffer), "%s", text);
+	*keys = 0;
+	for (char *name = strtok(buffer, "+"); name != NULL; name = strtok(NULL, "+"))
+	{
+		u8 i;
+		for (i = 0; i < sizeof(key_names) / sizeof(key_names[0]); i++)
+		{
+			if (strcasecmp(name, key_names[i]) == 0)
+				break;
+		}
+		if (i == sizeof(key_names) / sizeof(key_names[0]))
+			return FALSE;
+		*keys |= 1 << i;
+	}
+	return TRUE;
+}
+
+static BOOL LoadScript(const char *file)
+{
+	FILE *f = fopen(file, "r");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Error: Couldn't open %s\n", file);
+		return FALSE;
+	}
+	char line[256];
+	u32 number = 0;
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		number++;
+		char *comment = strchr(line, '#');
+		if (comment != NULL)
+			*comment = 0;
+		char word[4][32] = {{0}};
+		int words = sscanf(line, "%31s %31s %31s %31s", word[0], word[1], word[2], word[3]);
+		if (words <= 0)
+			continue;
+		if (command_count == MAX_COMMANDS - 1)
+		{
+			fprintf(stderr, "Error: %s has more than %d commands\n", file, MAX_COMMANDS - 1);
+			fclose(f);
+			return FALSE;
+		}
+		SimCommand *c = &commands[command_count];
+		memset(c, 0, sizeof(*c));
+		BOOL ok = TRUE;
+		if (strcasecmp(word[0], "boot") == 0 && words <= 2)
+		{
+			c->type = CMD_BOOT;
+			if (words == 2)
+				ok = ParseKeys(word[1], &c->keys);
+		}
+		else if (strcasecmp(word[0], "press") == 0 && words >= 2 && words <= 3)
+		{
+			c->type = CMD_PRESS;
+			c->frames = (words == 3) ? atoi(word[2]) : 2;
+			ok = ParseKeys(word[1], &c->keys) && c->frames > 0;
+		}
+		else if (strcasecmp(word[0], "wait") == 0 && words == 2)
+		{
+			c->type = CMD_WAIT;
+			c->frames = atoi(word[1]);
+			ok = c->frames > 0;
+		}
+		else if (strcasecmp(word[0], "snap") == 0 && words == 2)
+		{
+			c->type = CMD_SNAP;
+		}
+		else
+		{
+			ok = FALSE;
+		}
+		if (!ok)
+		{
+			fprintf(stderr, "Error: %s:%u: can't parse \"%s\"\n", file, number, word[0]);
+			fclose(f);
+			return FALSE;
+		}
+		snprintf(c->text, sizeof(c->text), "%s%s%s%s%s", word[0], words > 1 ? " " : "", word[1], words > 2 ? " " : "", word[2]);
+		if (command_count == 0 && c->type != CMD_BOOT)
+		{
+			// Scripts start with a power-on
+			commands[1] = *c;
+			memset(c, 0, sizeof(*c));
+			c->type = CMD_BOOT;
+			strcpy(c->text, "boot");
+			command_count++;
+		}
+		command_count++;
+	}
+	fclose(f);
+	return TRUE;
+}
+
+static void FinishCommand(const char *note)
+{
+	// Reports the work of the current command along with a checksum of the frame it left on screen
+	const SimCommand *c = &commands[sim->command];
+	RenderFrame(frame_rgb);
+	u32 crc = Crc32Update(0, frame_rgb, sizeof(frame_rgb));
+	if (frames_path != NULL)
+	{
+		char file[512];
+		if (c->type == CMD_SNAP)
+			snprintf(file, sizeof(file), "%s/%03u_%s.png", frames_path, sim->command, c->text + 5);
+		else
+			snprintf(file, sizeof(file), "%s/%03u.png", frames_path, sim->command);
+		if (!WritePng(file, frame_rgb))
+			fprintf(stderr, "Error: Couldn't write %s\n", file);
+	}
+
+	char *line = sim->lines[sim->command];
+	snprintf(line, MAX_LINE, "%03u %-20s frames=%u vram=%llu glyphs=%llu rom=%llu crc=%08X%s%s", sim->command, c->text, sim->counters.frames,
+			 (unsigned long long)sim->counters.vram, (unsigned long long)sim->counters.glyphs, (unsigned long long)sim->counters.rom, crc, note[0] ? " " : "", note);
+	printf("%s\n", line);
+	fflush(stdout);
+
+	memset(&sim->counters, 0, sizeof(sim->counters));
+	sim->command++;
+	sim->started = FALSE;
+	sim->reset = FALSE;
+}
+
+static void ScriptStep(void)
+{
+	while (sim->command < command_count)
+	{
+		const SimCommand *c = &commands[sim->command];
+		if (!sim->started)
+		{
+			if (c->type == CMD_BOOT)
+			{
+				// Power cycle, run by the parent process
+				fflush(stdout);
+				_exit(EXIT_BOOT);
+			}
+			sim->started = TRUE;
+			memset(&sim->counters, 0, sizeof(sim->counters));
+			if (c->type == CMD_PRESS)
+				keys_pressed = c->keys;
+		}
+		switch (c->type)
+		{
+		case CMD_PRESS:
+			// Held for the given number of frames, then released for two
+			if (sim->counters.frames == c->frames)
+				keys_pressed = 0;
+			if (sim->counters.frames < c->frames + 2)
+				return;
+			break;
+		case CMD_WAIT:
+			if (sim->counters.frames < c->frames)
+				return;
+			break;
+		default:
+			break;
+		}
+		FinishCommand("");
+	}
+	fflush(stdout);
+	_exit(EXIT_DONE);
+}
+
+static void SimFrame(void)
+{
+	// VBlank: the VCount interrupt of the highlight fires at line 160
+	if ((REG_IE & IRQ_VCOUNT) && irq_vcount != NULL)
+		irq_vcount();
+	sim->counters.frames++;
+
+	if (sim->booting)
+	{
+		// Boot keys stay held until the menu turns the display on
+		if ((REG_DISPCNT & LCDC_OFF) && sim->counters.frames < BOOT_TIMEOUT_FRAMES)
+			return;
+		sim->booting = FALSE;
+		keys_pressed = 0;
+		if (commands[sim->command].type == CMD_BOOT)
+		{
+			FinishCommand((REG_DISPCNT & LCDC_OFF) ? "timeout" : "");
+		}
+		else if (sim->reset)
+		{
+			FinishCommand("reset");
+		}
+		return;
+	}
+	ScriptStep();
+}
+
+////////////////////////////////
+// Compilation
+
+static BOOL LoadImage(const char *file)
+{
+	FILE *f = fopen(file, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Error: Couldn't open %s\n", file);
+		return FALSE;
+	}
+	memset((void *)AGB_ROM, 0xFF, ROM_WINDOW);
+	size_t size = fread((void *)AGB_ROM, 1, ROM_WINDOW, f);
+	fclose(f);
+	if (size < 0x40000)
+	{
+		fprintf(stderr, "Error: %s is too small for a compilation\n", file);
+		return FALSE;
+	}
+	return TRUE;
+}
+
+static void LoadMenuData(const char *fallback_font)
+{
+	// The background bitmap and its palette come right before the font, as the ROM Builder expects them
+	const u8 *rom = (const u8 *)AGB_ROM;
+	u32 menu_size = flash_itemlist_sector_offset * flash_sector_size;
+	for (u32 pos = 0; pos + 0x10 < menu_size; pos += 4)
+	{
+		if (memcmp(rom + pos, "LKFN\x01\x00", 6) != 0)
+			continue;
+		if (pos < sizeof(bgBitmap) + sizeof(bgPal))
+			break;
+		u32 bg_pos = pos - sizeof(bgBitmap) - sizeof(bgPal);
+		font_lkfn = rom + pos;
+		memcpy(bgBitmap, rom + bg_pos, sizeof(bgBitmap));
+		memcpy(bgPal, rom + bg_pos + sizeof(bgBitmap), sizeof(bgPal));
+		printf("Menu data:   font at 0x%X, background at 0x%X\n", pos, bg_pos);
+		return;
+	}
+
+	// Menu ROM without the usual data (e.g. a placeholder); use the repository's font on white
+	memset(bgBitmap, 0, sizeof(bgBitmap));
+	bgPal[0] = 0x7FFF;
+	FILE *f = fopen(fallback_font, "rb");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Error: No font in the compilation and couldn't open %s\n", fallback_font);
+		exit(1);
+	}
+	fseek(f, 0, SEEK_END);
+	long size = ftell(f);
+	fseek(f, 0, SEEK_SET);
+	u8 *data = malloc(size);
+	if (fread(data, 1, size, f) != (size_t)size)
+	{
+		fprintf(stderr, "Error: Couldn't read %s\n", fallback_font);
+		exit(1);
+	}
+	fclose(f);
+	font_lkfn = data;
+	printf("Menu data:   not found, using %s\n", fallback_font);
+}
+
+static BOOL FindItemList(u8 type)
+{
+	// The item list is the first sector after the menu; the status record follows it
+	const u8 *rom = (const u8 *)AGB_ROM;
+	u32 offset;
+	for (offset = 0x40000; offset < ROM_WINDOW; offset += 0x40000)
+	{
+		if (memcmp(rom + offset, "LKIL", 4) == 0)
+			break;
+	}
+	if (offset >= ROM_WINDOW)
+	{
+		offset = 0x40000;
+		printf("Item list:   not found\n");
+	}
+
+	// The ROM Builder writes the status record into the sector after the item list
+	u32 sector_size = 0x40000;
+	const FlashStatus *status = (const FlashStatus *)(rom + offset + 0x20000);
+	if (status->magic == MAGIC_FLASH_STATUS)
+		sector_size = 0x20000;
+	else
+		status = (const FlashStatus *)(rom + offset + 0x40000);
+	if (type == 0)
+	{
+		// Chip type cached by the last launch, otherwise any chip with that sector size
+		if (status->magic == MAGIC_FLASH_STATUS && status->flash_type >= 1 && status->flash_type <= 3 && status->flash_type_check == (u8)~status->flash_type && FlashGetSectorSize(status->flash_type) == sector_size)
+			type = status->flash_type;
+		else
+			type = (sector_size == 0x40000) ? 1 : 2;
+	}
+	flash_type = type;
+	flash_sector_size = FlashGetSectorSize(type);
+	flash_itemlist_sector_offset = offset / flash_sector_size;
+	flash_status_sector_offset = flash_itemlist_sector_offset + 1;
+	flash_save_sector_offset = flash_status_sector_offset + 1;
+	printf("Item list:   0x%X (flash type %u, status at 0x%X)\n", offset, type, flash_status_sector_offset * flash_sector_size);
+	return TRUE;
+}
+
+u32 FlashGetSectorSize(u8 type)
+{
+	return (type == 1) ? 0x40000 : 0x20000;
+}
+
+////////////////////////////////
+// Reports
+
+static BOOL ReadReportValue(const char *line, const char *name, unsigned long long *value)
+{
+	char key[32];
+	snprintf(key, sizeof(key), " %s=", name);
+	const char *p = strstr(line, key);
+	if (p == NULL)
+		return FALSE;
+	*value = strtoull(p + strlen(key), NULL, (strcmp(name, "crc") == 0) ? 16 : 10);
+	return TRUE;
+}
+
+static u32 CompareBaseline(const char *file)
+{
+	FILE *f = fopen(file, "r");
+	if (f == NULL)
+	{
+		fprintf(stderr, "Error: Couldn't open %s\n", file);
+		return 1;
+	}
+	static const char *names[] = {"frames", "vram", "glyphs", "rom", "crc"};
+	static char baseline_texts[MAX_COMMANDS][sizeof(commands[0].text)];
+	u32 baseline_count = 0;
+	u32 regressions = 0;
+	char line[MAX_LINE * 2];
+	printf("\nCompared to %s:\n", file);
+	while (fgets(line, sizeof(line), f) != NULL)
+	{
+		// Steps are matched by command and how often it came before, so inserting steps into a script keeps the rest comparable
+		const char *end = strstr(line, " frames=");
+		if (line[0] == '#' || strlen(line) < 5 || end == NULL)
+			continue;
+		char text[sizeof(commands[0].text)];
+		u32 length = end - (line + 4);
+		while (length > 0 && line[3 + length] == ' ')
+			length--;
+		if (length >= sizeof(text))
+			continue;
+		memcpy(text, line + 4, length);
+		text[length] = 0;
+
+		u32 occurrence = 0;
+		for (u32 i = 0; i < baseline_count; i++)
+		{
+			if (strcmp(baseline_texts[i], text) == 0)
+				occurrence++;
+		}
+		if (baseline_count < MAX_COMMANDS)
+			strcpy(baseline_texts[baseline_count++], text);
+		u32 number;
+		for (number = 0; number < command_count; number++)
+		{
+			if (strcmp(commands[number].text, text) == 0 && occurrence-- == 0)
+				break;
+		}
+		if (number == command_count)
+			continue;
+		const char *current = sim->lines[number];
+		if (current[0] == 0)
+			continue;
+		for (u8 i = 0; i < sizeof(names) / sizeof(names[0]); i++)
+		{
+			unsigned long long old, new;
+			if (!ReadReportValue(line, names[i], &old) || !ReadReportValue(current, names[i], &new) || old == new)
+				continue;
+			// Any change of the picture counts, for the counters only growth does
+			BOOL worse = (i == 4) || (new > old);
+			if (worse)
+				regressions++;
+			if (i == 4)
+				printf("%03u %-20s crc %08llX -> %08llX (changed)\n", number, commands[number].text, old, new);
+			else
+				printf("%03u %-20s %-6s %llu -> %llu%s\n", number, commands[number].text, names[i], old, new, worse ? " (worse)" : "");
+		}
+	}
+	fclose(f);
+	printf("%u regression(s)\n", regressions);
+	return regressions;
+}
+
+static void Usage(const char *name)
+{
+	printf("Usage: %s [options] COMPILATION.gba SCRIPT\n", name);
+	printf("  --frames DIR             write the screen after every script step as PNG files\n");
+	printf("  --report FILE            write the step report to a file\n");
+	printf("  --baseline FILE          compare against an earlier report, exit code 1 on regressions\n");
+	printf("  --loops-per-frame N      menu loop iterations per frame (default: 1000)\n");
+	printf("  --type N                 flash chip type 1 to 3 (default: detected from the compilation)\n");
+}
+
+int main(int argc, char **argv)
+{
+	const char *report_file = NULL;
+	const char *baseline_file = NULL;
+	u8 type = 0;
+	static const struct option options[] = {
+		{"frames", required_argument, 0, 'f'},
+		{"report", required_argument, 0, 'r'},
+		{"baseline", required_argument, 0, 'b'},
+		{"loops-per-frame", required_argument, 0, 'l'},
+		{"type", required_argument, 0, 't'},
+		{"help", no_argument, 0, 'h'},
+		{0, 0, 0, 0},
+	};
+	int opt;
+	while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1)
+	{
+		switch (opt)
+		{
+		case 'f':
+			frames_path = optarg;
+			break;
+		case 'r':
+			report_file = optarg;
+			break;
+		case 'b':
+			baseline_file = optarg;
+			break;
+		case 'l':
+			loops_per_frame = atoi(optarg);
+			break;
+		case 't':
+			type = atoi(optarg);
+			break;
+		default:
+			Usage(argv[0]);
+			return opt == 'h' ? 0 : 1;
+		}
+	}
+	if (argc - optind != 2 || loops_per_frame == 0 || type > 3)
+	{
+		Usage(argv[0]);
+		return 1;
+	}
+
+	if (frames_path != NULL && mkdir(frames_path, 0777) != 0 && errno != EEXIST)
+	{
+		fprintf(stderr, "Error: Couldn't create %s\n", frames_path);
+		return 1;
+	}
+
+	Crc32Init();
+	SimMapMemory();
+	if (!LoadImage(argv[optind]) || !LoadScript(argv[optind + 1]))
+		return 1;
+	FindItemList(type);
+	LoadMenuData(FALLBACK_FONT);
+
+	sim = mmap(NULL, sizeof(SimState), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+	if (sim == MAP_FAILED)
+	{
+		fprintf(stderr, "Error: Couldn't allocate the shared state\n");
+		return 1;
+	}
+	memset(sim, 0, sizeof(SimState));
+
+	// Every power cycle runs in a fresh child process, so the menu starts with clean globals like after a reset
+	printf("\n");
+	u32 boots = 0;
+	u32 launches = 0;
+	while (sim->command < command_count)
+	{
+		const SimCommand *c = &commands[sim->command];
+		if (c->type == CMD_BOOT)
+		{
+			sim->started = TRUE;
+			sim->boot_keys = c->keys;
+			memset(&sim->counters, 0, sizeof(sim->counters));
+		}
+		sim->booting = TRUE;
+		boots++;
+		fflush(stdout);
+		pid_t pid = fork();
+		if (pid == 0)
+		{
+			loops = 0;
+			keys_pressed = sim->boot_keys;
+			sim->boot_keys = 0;
+			SimUpdateVCount();
+			MenuMain();
+			_exit(EXIT_DONE);
+		}
+		int status;
+		waitpid(pid, &status, 0);
+		if (!WIFEXITED(status))
+		{
+			fprintf(stderr, "Error: Menu crashed at step %03u (%s)\n", sim->command, commands[sim->command].text);
+			return 1;
+		}
+		switch (WEXITSTATUS(status))
+		{
+		case EXIT_DONE:
+			sim->command = command_count;
+			break;
+		case EXIT_LAUNCH:
+			// Write the status record like BootGame() would, then skip to the next power-on
+			memcpy((void *)(AGB_ROM + flash_status_sector_offset * flash_sector_size), &sim->status, sizeof(FlashStatus));
+			launches++;
+			while (sim->command < command_count && commands[sim->command].type != CMD_BOOT)
+				sim->command++;
+			break;
+		case EXIT_BOOT:
+		case EXIT_RESET:
+			break;
+		default:
+			fprintf(stderr, "Error: Menu exited with code %d at step %03u\n", WEXITSTATUS(status), sim->command);
+			return 1;
+		}
+	}
+	printf("\n%u step(s), %u power cycle(s), %u launch(es)\n", command_count, boots, launches);
+
+	if (report_file != NULL)
+	{
+		FILE *f = fopen(report_file, "w");
+		if (f == NULL)
+		{
+			fprintf(stderr, "Error: Couldn't write %s\n", report_file);
+			return 1;
+		}
+		fprintf(f, "# Menu simulator report (%u loops per frame)\n", loops_per_frame);
+		for (u32 i = 0; i < command_count; i++)
+		{
+			if (sim->lines[i][0])
+				fprintf(f, "%s\n", sim->lines[i]);
+		}
+		fclose(f);
+	}
+	if (baseline_file != NULL)
+		return CompareBaseline(baseline_file) ? 1 : 0;
+	return 0;
+}
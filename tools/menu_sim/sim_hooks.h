@@ -0,0 +1,22 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Force-included before the menu sources so that the work counters in
+main.h report to the simulator.
+*/
+
+#ifndef SIM_HOOKS_H_
+#define SIM_HOOKS_H_
+
+#include <stdint.h>
+
+void SimTraceVram(volatile void *address, uint32_t bytes);
+void SimTraceRom(uint32_t bytes);
+void SimTraceGlyph(uint32_t bytes);
+
+#define _TRACE_VRAM_WRITE(address, bytes) SimTraceVram((address), (bytes))
+#define _TRACE_ROM_READ(bytes) SimTraceRom(bytes)
+#define _TRACE_GLYPH(bytes) SimTraceGlyph(bytes)
+
+#endif
@@ -0,0 +1,17 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Stand-in for the grit-generated background header.
+*/
+
+#ifndef SHIM_BG_H_
+#define SHIM_BG_H_
+
+#define bgBitmapLen 38400
+#define bgPalLen 512
+
+extern const unsigned int bgBitmap[9600];
+extern const unsigned short bgPal[256];
+
+#endif
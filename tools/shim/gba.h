@@ -0,0 +1,65 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Minimal libgba replacement for host-side builds of the menu sources.
+GBA memory regions are mapped at their real addresses by the host tool
+(see SimMapMemory()), so register and VRAM accesses work unchanged.
+*/
+
+#ifndef SHIM_GBA_H_
+#define SHIM_GBA_H_
+
+#include <stdint.h>
+
+typedef uint64_t u64;
+typedef uint32_t u32;
+typedef uint16_t u16;
+typedef uint8_t u8;
+typedef int32_t s32;
+typedef int16_t s16;
+typedef int8_t s8;
+typedef volatile uint32_t vu32;
+typedef volatile uint16_t vu16;
+typedef volatile uint8_t vu8;
+
+#define IWRAM_CODE
+#define EWRAM_CODE
+#define IWRAM_DATA
+#define EWRAM_DATA
+#define EWRAM_BSS
+
+#define REG_BASE 0x04000000
+#define REG_DISPCNT (*(vu16 *)(REG_BASE + 0x00))
+#define REG_DISPSTAT (*(vu16 *)(REG_BASE + 0x04))
+#define REG_VCOUNT (*(vu16 *)(REG_BASE + 0x06))
+#define REG_BLDCNT (*(vu16 *)(REG_BASE + 0x50))
+#define REG_BLDY (*(vu16 *)(REG_BASE + 0x54))
+#define REG_DMA0SAD (*(vu32 *)(REG_BASE + 0xB0))
+#define REG_DMA0DAD (*(vu32 *)(REG_BASE + 0xB4))
+#define REG_DMA0CNT (*(vu32 *)(REG_BASE + 0xB8))
+#define REG_TM0CNT (*(vu32 *)(REG_BASE + 0x100))
+#define REG_TM0CNT_L (*(vu16 *)(REG_BASE + 0x100))
+#define REG_TM0CNT_H (*(vu16 *)(REG_BASE + 0x102))
+#define REG_TM1CNT (*(vu32 *)(REG_BASE + 0x104))
+#define REG_TM1CNT_L (*(vu16 *)(REG_BASE + 0x104))
+#define REG_TM1CNT_H (*(vu16 *)(REG_BASE + 0x106))
+#define REG_TM2CNT_L (*(vu16 *)(REG_BASE + 0x108))
+#define REG_TM2CNT_H (*(vu16 *)(REG_BASE + 0x10A))
+#define REG_TM3CNT_L (*(vu16 *)(REG_BASE + 0x10C))
+#define REG_TM3CNT_H (*(vu16 *)(REG_BASE + 0x10E))
+#define REG_KEYINPUT (*(vu16 *)(REG_BASE + 0x130))
+#define REG_IE (*(vu16 *)(REG_BASE + 0x200))
+#define REG_IF (*(vu16 *)(REG_BASE + 0x202))
+#define REG_WAITCNT (*(vu16 *)(REG_BASE + 0x204))
+#define REG_IME (*(vu16 *)(REG_BASE + 0x208))
+
+void SimMapMemory(void);
+
+#include <gba_dma.h>
+#include <gba_input.h>
+#include <gba_interrupt.h>
+#include <gba_systemcalls.h>
+#include <gba_video.h>
+
+#endif
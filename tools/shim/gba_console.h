@@ -0,0 +1,6 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+The menu includes gba_console.h but uses none of it.
+*/
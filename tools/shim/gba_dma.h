@@ -0,0 +1,32 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+DMA definitions of libgba; host tools provide dmaCopy().
+*/
+
+#ifndef SHIM_GBA_DMA_H_
+#define SHIM_GBA_DMA_H_
+
+#include <gba.h>
+
+#define DMA_DST_INC (0 << 21)
+#define DMA_DST_DEC (1 << 21)
+#define DMA_DST_FIXED (2 << 21)
+#define DMA_DST_RELOAD (3 << 21)
+#define DMA_SRC_INC (0 << 23)
+#define DMA_SRC_DEC (1 << 23)
+#define DMA_SRC_FIXED (2 << 23)
+#define DMA_REPEAT (1 << 25)
+#define DMA16 (0 << 26)
+#define DMA32 (1 << 26)
+#define DMA_IMMEDIATE (0 << 28)
+#define DMA_VBLANK (1 << 28)
+#define DMA_HBLANK (2 << 28)
+#define DMA_SPECIAL (3 << 28)
+#define DMA_IRQ (1 << 30)
+#define DMA_ENABLE (1u << 31)
+
+void dmaCopy(const void *source, void *dest, u32 size);
+
+#endif
@@ -0,0 +1,28 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Key input functions of libgba; host tools provide the implementation.
+*/
+
+#ifndef SHIM_GBA_INPUT_H_
+#define SHIM_GBA_INPUT_H_
+
+#include <gba.h>
+
+#define KEY_A 0x0001
+#define KEY_B 0x0002
+#define KEY_SELECT 0x0004
+#define KEY_START 0x0008
+#define KEY_RIGHT 0x0010
+#define KEY_LEFT 0x0020
+#define KEY_UP 0x0040
+#define KEY_DOWN 0x0080
+#define KEY_R 0x0100
+#define KEY_L 0x0200
+
+void scanKeys(void);
+u16 keysDown(void);
+u16 keysHeld(void);
+
+#endif
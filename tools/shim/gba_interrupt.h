@@ -0,0 +1,24 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Interrupt functions of libgba; host tools provide the implementation.
+*/
+
+#ifndef SHIM_GBA_INTERRUPT_H_
+#define SHIM_GBA_INTERRUPT_H_
+
+#include <gba.h>
+
+#define IRQ_VBLANK 0x0001
+#define IRQ_HBLANK 0x0002
+#define IRQ_VCOUNT 0x0004
+
+typedef void (*IntFn)(void);
+
+void irqInit(void);
+void irqSet(int mask, IntFn function);
+void irqEnable(int mask);
+void irqDisable(int mask);
+
+#endif
@@ -0,0 +1,40 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+*/
+
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <sys/mman.h>
+
+#include <gba.h>
+
+typedef struct SimRegion_
+{
+	u32 address;
+	u32 size;
+	const char *name;
+} SimRegion;
+
+static const SimRegion sim_regions[] = {
+	{0x04000000, 0x1000, "I/O registers"},
+	{0x05000000, 0x1000, "palette RAM"},
+	{0x06000000, 0x18000, "VRAM"},
+	{0x07000000, 0x1000, "OAM"},
+	{0x08000000, 0x2000000, "ROM"},
+	{0x0E000000, 0x10000, "SRAM"},
+};
+
+void SimMapMemory(void)
+{
+	for (u32 i = 0; i < sizeof(sim_regions) / sizeof(sim_regions[0]); i++)
+	{
+		void *p = mmap((void *)(uintptr_t)sim_regions[i].address, sim_regions[i].size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED_NOREPLACE, -1, 0);
+		if (p != (void *)(uintptr_t)sim_regions[i].address)
+		{
+			fprintf(stderr, "Error: Couldn't map %s at 0x%08X\n", sim_regions[i].name, sim_regions[i].address);
+			exit(1);
+		}
+	}
+}
@@ -0,0 +1,14 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+BIOS calls of libgba; host tools provide the implementation.
+*/
+
+#ifndef SHIM_GBA_SYSTEMCALLS_H_
+#define SHIM_GBA_SYSTEMCALLS_H_
+
+void SystemCall(int number);
+void VBlankIntrWait(void);
+
+#endif
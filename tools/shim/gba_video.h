@@ -0,0 +1,23 @@
+/*
+GBA Multi Game Menu
+Author: Lesserkuma (github.com/lesserkuma)
+
+Video definitions of libgba used by the menu sources.
+*/
+
+#ifndef SHIM_GBA_VIDEO_H_
+#define SHIM_GBA_VIDEO_H_
+
+#include <gba.h>
+
+#define MODE_4 0x0004
+#define LCDC_OFF 0x0080
+#define OBJ_1D_MAP 0x0040
+#define BG2_ENABLE 0x0400
+#define OBJ_ENABLE 0x1000
+
+#define SetMode(mode) (REG_DISPCNT = (mode))
+
+#define BG_PALETTE ((u16 *)0x05000000)
+
+#endif